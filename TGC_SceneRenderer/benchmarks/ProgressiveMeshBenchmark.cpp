@@ -0,0 +1,482 @@
+// standalone progressive meshes benchmark, only the cpu side of generation and
+// reduction runs so no gl context is created, link it with the renderer sources
+// usage: ProgressiveMeshBenchmark [resources root] [output json]
+#include "..\utils\ProgressiveMeshes.h"
+#include "..\core\Data.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+// vertex count ratios measured on every mesh
+static const float LEVEL_RATIOS[] = { 0.75f, 0.5f, 0.25f, 0.125f, 0.0625f };
+static const unsigned int LEVEL_COUNT = sizeof(LEVEL_RATIOS) / sizeof(LEVEL_RATIOS[0]);
+// procedural high poly meshes size
+static const unsigned int SPHERE_RINGS = 256;
+static const unsigned int SPHERE_SEGMENTS = 512;
+static const unsigned int TERRAIN_SIZE = 256;
+// error measurement grid, cells per axis limit
+static const int GRID_MAX_CELLS = 128;
+
+struct Geometry {
+    std::string name;
+    std::vector<types::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<types::Face> faces;
+};
+
+struct LevelResult {
+    float ratio;
+    unsigned int vertexCount;
+    unsigned int polyCount;
+    double reductionTime;
+    float hausdorff;
+    float rms;
+};
+
+// faces point to the geometry vertices, so they are built once these are final
+static void buildFaces(Geometry &geometry)
+{
+    geometry.faces.clear();
+
+    for (unsigned int i = 0; i + 2 < geometry.indices.size(); i += 3) {
+        const unsigned int *face = &geometry.indices[i];
+        geometry.faces.push_back(types::Face(geometry.vertices[face[0]], geometry.vertices[face[1]], geometry.vertices[face[2]], face[0], face[1], face[2]));
+    }
+}
+
+static void addVertex(Geometry &geometry, const glm::vec3 &position)
+{
+    types::Vertex v;
+    v.position = position;
+    geometry.vertices.push_back(v);
+}
+
+static void addFace(Geometry &geometry, const unsigned int a, const unsigned int b, const unsigned int c)
+{
+    geometry.indices.push_back(a);
+    geometry.indices.push_back(b);
+    geometry.indices.push_back(c);
+}
+
+// every submesh of the stored models, imported as the engine does
+static bool loadStoredMesh(const std::string &filename, const std::string &name, std::vector<Geometry> &out)
+{
+    Assimp::Importer importer;
+    const aiScene *pScene = importer.ReadFile(filename.c_str(), scene::Mesh::IMPORT_FLAGS);
+
+    if (!pScene) {
+        std::cout << "ProgressiveMeshBenchmark " << "Error parsing '" << filename << "': '" << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < pScene->mNumMeshes; i++) {
+        const aiMesh *paiMesh = pScene->mMeshes[i];
+        out.push_back(Geometry());
+        Geometry &geometry = out.back();
+        geometry.name = pScene->mNumMeshes > 1 ? name + "#" + std::to_string(i) : name;
+
+        for (unsigned int j = 0; j < paiMesh->mNumVertices; j++) {
+            addVertex(geometry, glm::vec3(paiMesh->mVertices[j].x, paiMesh->mVertices[j].y, paiMesh->mVertices[j].z));
+        }
+
+        for (unsigned int j = 0; j < paiMesh->mNumFaces; j++) {
+            if (paiMesh->mFaces[j].mNumIndices != 3) { continue; }
+
+            addFace(geometry, paiMesh->mFaces[j].mIndices[0], paiMesh->mFaces[j].mIndices[1], paiMesh->mFaces[j].mIndices[2]);
+        }
+
+        buildFaces(geometry);
+    }
+
+    return true;
+}
+
+// closed uv sphere with a bumpy radius so collapses have some curvature to weigh
+static Geometry proceduralSphere(const unsigned int rings, const unsigned int segments)
+{
+    Geometry geometry;
+    geometry.name = "ProceduralSphere";
+    const float pi = glm::pi<float>();
+    addVertex(geometry, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    for (unsigned int i = 1; i < rings; i++) {
+        for (unsigned int j = 0; j < segments; j++) {
+            float theta = pi * i / rings, phi = 2.0f * pi * j / segments;
+            float radius = 1.0f + 0.05f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+            addVertex(geometry, radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+        }
+    }
+
+    addVertex(geometry, glm::vec3(0.0f, -1.0f, 0.0f));
+    const unsigned int southPole = geometry.vertices.size() - 1;
+
+    for (unsigned int j = 0; j < segments; j++) {
+        unsigned int next = (j + 1) % segments;
+        addFace(geometry, 0, 1 + next, 1 + j);
+
+        for (unsigned int i = 0; i + 2 < rings; i++) {
+            unsigned int a = 1 + i * segments + j, b = 1 + i * segments + next;
+            unsigned int c = a + segments, d = b + segments;
+            addFace(geometry, a, b, d);
+            addFace(geometry, a, d, c);
+        }
+
+        addFace(geometry, southPole, 1 + (rings - 2) * segments + j, 1 + (rings - 2) * segments + next);
+    }
+
+    buildFaces(geometry);
+    return geometry;
+}
+
+// open height field, exercises the border handling
+static Geometry proceduralTerrain(const unsigned int size)
+{
+    Geometry geometry;
+    geometry.name = "ProceduralTerrain";
+
+    for (unsigned int y = 0; y <= size; y++) {
+        for (unsigned int x = 0; x <= size; x++) {
+            float height = std::sin(x * 0.3f) * std::cos(y * 0.2f) * 2.0f + std::sin(x * 0.05f + y * 0.07f) * 8.0f;
+            addVertex(geometry, glm::vec3((float)x, height, (float)y));
+        }
+    }
+
+    for (unsigned int y = 0; y < size; y++) {
+        for (unsigned int x = 0; x < size; x++) {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+            addFace(geometry, a, c, b);
+            addFace(geometry, b, c, d);
+        }
+    }
+
+    buildFaces(geometry);
+    return geometry;
+}
+
+static glm::vec3 closestPointTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+
+    if (d1 <= 0.0f && d2 <= 0.0f) { return a; }
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+
+    if (d3 >= 0.0f && d4 <= d3) { return b; }
+
+    float vc = d1 * d4 - d3 * d2;
+
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { return a + ab * (d1 / (d1 - d3)); }
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+
+    if (d6 >= 0.0f && d5 <= d6) { return c; }
+
+    float vb = d5 * d2 - d1 * d6;
+
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { return a + ac * (d2 / (d2 - d6)); }
+
+    float va = d3 * d6 - d5 * d4;
+
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) { return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))); }
+
+    float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// uniform grid over the triangles of a mesh for closest surface point queries
+class TriangleGrid {
+    public:
+        TriangleGrid(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices);
+        // distance from p to the closest triangle
+        float distance(const glm::vec3 &p);
+
+    private:
+        const std::vector<glm::vec3> &positions;
+        const std::vector<unsigned int> &indices;
+        glm::vec3 minPoint;
+        float cellSize;
+        int cells[3];
+        // triangles of every cell, cell i triangles are in [cellStart[i], cellStart[i + 1])
+        std::vector<unsigned int> cellStart;
+        std::vector<unsigned int> cellTriangles;
+        // last query that tested each triangle, triangles span several cells
+        std::vector<unsigned int> triangleQuery;
+        unsigned int query;
+        int cellCoord(const float value, const int axis) const;
+        void testCell(const int x, const int y, const int z, const glm::vec3 &p, float &best);
+};
+
+TriangleGrid::TriangleGrid(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices) : positions(positions), indices(indices), query(0)
+{
+    const unsigned int triangleCount = indices.size() / 3;
+    glm::vec3 maxPoint(-std::numeric_limits<float>::infinity());
+    minPoint = glm::vec3(std::numeric_limits<float>::infinity());
+    float area = 0.0f;
+
+    for (unsigned int i = 0; i < triangleCount; i++) {
+        const glm::vec3 &a = positions[indices[i * 3]], &b = positions[indices[i * 3 + 1]], &c = positions[indices[i * 3 + 2]];
+        minPoint = glm::min(minPoint, glm::min(a, glm::min(b, c)));
+        maxPoint = glm::max(maxPoint, glm::max(a, glm::max(b, c)));
+        area += glm::length(glm::cross(b - a, c - a)) * 0.5f;
+    }
+
+    // about a couple of triangles per cell, bounded for very thin or wide meshes
+    glm::vec3 extent = maxPoint - minPoint;
+    float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+    cellSize = std::max(std::sqrt(area / std::max(triangleCount, 1u)) * 2.0f, maxExtent / GRID_MAX_CELLS);
+    cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+
+    for (int k = 0; k < 3; k++) {
+        cells[k] = std::max(1, std::min(GRID_MAX_CELLS, (int)std::ceil(extent[k] / cellSize)));
+    }
+
+    // two passes, count then fill, keeps the cells triangles contiguous
+    cellStart.assign(cells[0] * cells[1] * cells[2] + 1, 0);
+
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<unsigned int> cursor(cellStart.begin(), cellStart.end() - 1);
+
+        for (unsigned int i = 0; i < triangleCount; i++) {
+            const glm::vec3 &a = positions[indices[i * 3]], &b = positions[indices[i * 3 + 1]], &c = positions[indices[i * 3 + 2]];
+            glm::vec3 triMin = glm::min(a, glm::min(b, c)), triMax = glm::max(a, glm::max(b, c));
+
+            for (int z = cellCoord(triMin.z, 2); z <= cellCoord(triMax.z, 2); z++) {
+                for (int y = cellCoord(triMin.y, 1); y <= cellCoord(triMax.y, 1); y++) {
+                    for (int x = cellCoord(triMin.x, 0); x <= cellCoord(triMax.x, 0); x++) {
+                        unsigned int cell = (z * cells[1] + y) * cells[0] + x;
+
+                        if (pass == 0) { cellStart[cell + 1]++; }
+                        else { cellTriangles[cursor[cell]++] = i; }
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (unsigned int i = 1; i < cellStart.size(); i++) { cellStart[i] += cellStart[i - 1]; }
+
+            cellTriangles.resize(cellStart.back());
+        }
+    }
+
+    triangleQuery.assign(triangleCount, 0);
+}
+
+int TriangleGrid::cellCoord(const float value, const int axis) const
+{
+    return std::max(0, std::min(cells[axis] - 1, (int)((value - minPoint[axis]) / cellSize)));
+}
+
+void TriangleGrid::testCell(const int x, const int y, const int z, const glm::vec3 &p, float &best)
+{
+    if (x < 0 || y < 0 || z < 0 || x >= cells[0] || y >= cells[1] || z >= cells[2]) { return; }
+
+    unsigned int cell = (z * cells[1] + y) * cells[0] + x;
+
+    for (unsigned int i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+        unsigned int triangle = cellTriangles[i];
+
+        if (triangleQuery[triangle] == query) { continue; }
+
+        triangleQuery[triangle] = query;
+        const unsigned int *face = &indices[triangle * 3];
+        best = std::min(best, glm::length(p - closestPointTriangle(p, positions[face[0]], positions[face[1]], positions[face[2]])));
+    }
+}
+
+float TriangleGrid::distance(const glm::vec3 &p)
+{
+    if (indices.empty()) { return std::numeric_limits<float>::infinity(); }
+
+    query++;
+    float best = std::numeric_limits<float>::infinity();
+    int c[3] = { cellCoord(p.x, 0), cellCoord(p.y, 1), cellCoord(p.z, 2) };
+    int maxRing = std::max(cells[0], std::max(cells[1], cells[2]));
+
+    // cells in ring r + 1 are at least r cells away, stop once nothing there can be closer
+    for (int r = 0; r <= maxRing; r++) {
+        for (int dx = -r; dx <= r; dx++) {
+            for (int dy = -r; dy <= r; dy++) {
+                if (std::abs(dx) == r || std::abs(dy) == r) {
+                    for (int dz = -r; dz <= r; dz++) { testCell(c[0] + dx, c[1] + dy, c[2] + dz, p, best); }
+                } else {
+                    testCell(c[0] + dx, c[1] + dy, c[2] - r, p, best);
+
+                    if (r > 0) { testCell(c[0] + dx, c[1] + dy, c[2] + r, p, best); }
+                }
+            }
+        }
+
+        if (best <= r * cellSize) { break; }
+    }
+
+    return best;
+}
+
+// one sided distances from the surface a samples, its vertices and faces
+// centroids, to the surface b, accumulates the max and squared sum
+static void sampleDistances(const std::vector<glm::vec3> &positionsA, const std::vector<unsigned int> &indicesA, TriangleGrid &surfaceB,
+                            float &maxDistance, double &squaredSum, unsigned int &samples)
+{
+    std::vector<bool> sampled(positionsA.size(), false);
+
+    for (unsigned int i = 0; i + 2 < indicesA.size(); i += 3) {
+        glm::vec3 centroid(0.0f);
+
+        for (int j = 0; j < 3; j++) {
+            unsigned int v = indicesA[i + j];
+            centroid += positionsA[v];
+
+            if (sampled[v]) { continue; }
+
+            sampled[v] = true;
+            float d = surfaceB.distance(positionsA[v]);
+            maxDistance = std::max(maxDistance, d);
+            squaredSum += (double)d * d;
+            samples++;
+        }
+
+        float d = surfaceB.distance(centroid / 3.0f);
+        maxDistance = std::max(maxDistance, d);
+        squaredSum += (double)d * d;
+        samples++;
+    }
+}
+
+static std::vector<glm::vec3> positionsOf(const std::vector<types::Vertex> &vertices)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+
+    for (unsigned int i = 0; i < vertices.size(); i++) { positions[i] = vertices[i].position; }
+
+    return positions;
+}
+
+static double elapsedMilliseconds(const std::chrono::high_resolution_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// json numbers can't be inf or nan
+static std::string jsonNumber(const double value)
+{
+    if (value != value || std::abs(value) == std::numeric_limits<double>::infinity()) { return "null"; }
+
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+static void benchmark(const Geometry &original, const utils::CollapseCost costFunction, const char *costName, std::ostream &json, const bool first)
+{
+    std::vector<glm::vec3> originalPositions = positionsOf(original.vertices);
+    TriangleGrid originalSurface(originalPositions, original.indices);
+    glm::vec3 minPoint = originalPositions.empty() ? glm::vec3(0.0f) : originalPositions[0], maxPoint = minPoint;
+
+    for (auto it = originalPositions.begin(); it != originalPositions.end(); ++it) {
+        minPoint = glm::min(minPoint, *it);
+        maxPoint = glm::max(maxPoint, *it);
+    }
+
+    // generation and permutation modify the geometry, the original stays for the error
+    Geometry geometry = original;
+    buildFaces(geometry);
+    utils::ProgressiveMesh progressiveMesh(costFunction);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    progressiveMesh.generateProgressiveMesh(geometry.vertices, geometry.faces);
+    double generationTime = elapsedMilliseconds(startTime);
+    progressiveMesh.permuteVertices(geometry.vertices, geometry.indices, geometry.faces);
+    std::vector<LevelResult> levels;
+
+    for (unsigned int i = 0; i < LEVEL_COUNT; i++) {
+        LevelResult level;
+        level.ratio = LEVEL_RATIOS[i];
+        level.vertexCount = (unsigned int)(LEVEL_RATIOS[i] * geometry.vertices.size());
+        level.polyCount = 0;
+        level.hausdorff = level.rms = std::numeric_limits<float>::infinity();
+        startTime = std::chrono::high_resolution_clock::now();
+        utils::ProgressiveMesh::ReducedMesh *reduced = progressiveMesh.reduceVerticesCount(geometry.vertices, geometry.indices, geometry.faces, level.vertexCount);
+        level.reductionTime = elapsedMilliseconds(startTime);
+
+        if (reduced && !reduced->indices.empty()) {
+            std::vector<glm::vec3> reducedPositions = positionsOf(reduced->vertices);
+            TriangleGrid reducedSurface(reducedPositions, reduced->indices);
+            float maxDistance = 0.0f; double squaredSum = 0.0; unsigned int samples = 0;
+            // symmetric, reduced to original and original to reduced
+            sampleDistances(originalPositions, original.indices, reducedSurface, maxDistance, squaredSum, samples);
+            sampleDistances(reducedPositions, reduced->indices, originalSurface, maxDistance, squaredSum, samples);
+            level.polyCount = reduced->indices.size() / 3;
+            level.hausdorff = maxDistance;
+            level.rms = (float)std::sqrt(squaredSum / std::max(samples, 1u));
+        }
+
+        delete reduced;
+        levels.push_back(level);
+    }
+
+    std::cout << "ProgressiveMeshBenchmark " << original.name << " (" << costName << ") vertices " << original.vertices.size() << " faces " << original.faces.size();
+    std::cout << " generated in " << generationTime << "ms using " << progressiveMesh.generationPeakBytes / 1024 << "KB" << std::endl;
+    json << (first ? "" : ",") << "\n        {\n";
+    json << "            \"mesh\": \"" << original.name << "\",\n";
+    json << "            \"costFunction\": \"" << costName << "\",\n";
+    json << "            \"vertices\": " << original.vertices.size() << ",\n";
+    json << "            \"faces\": " << original.faces.size() << ",\n";
+    json << "            \"diagonal\": " << jsonNumber(glm::length(maxPoint - minPoint)) << ",\n";
+    json << "            \"generationMs\": " << jsonNumber(generationTime) << ",\n";
+    json << "            \"peakBytes\": " << progressiveMesh.generationPeakBytes << ",\n";
+    json << "            \"levels\": [";
+
+    for (unsigned int i = 0; i < levels.size(); i++) {
+        std::cout << "    level " << levels[i].ratio << " faces " << levels[i].polyCount << " in " << levels[i].reductionTime << "ms ";
+        std::cout << "hausdorff " << levels[i].hausdorff << " rms " << levels[i].rms << std::endl;
+        json << (i == 0 ? "" : ",") << "\n                { ";
+        json << "\"ratio\": " << jsonNumber(levels[i].ratio) << ", ";
+        json << "\"vertices\": " << levels[i].vertexCount << ", ";
+        json << "\"faces\": " << levels[i].polyCount << ", ";
+        json << "\"reductionMs\": " << jsonNumber(levels[i].reductionTime) << ", ";
+        json << "\"hausdorff\": " << jsonNumber(levels[i].hausdorff) << ", ";
+        json << "\"rms\": " << jsonNumber(levels[i].rms) << " }";
+    }
+
+    json << "\n            ]\n        }";
+}
+
+int main(int argc, char **argv)
+{
+    std::string resourcesRoot = argc > 1 ? argv[1] : ".";
+    std::string outputFilename = argc > 2 ? argv[2] : "ProgressiveMeshBenchmark.json";
+    std::vector<Geometry> meshes;
+
+    // without core::Data::Initialize, which needs gl, the execution dir stays empty
+    for (unsigned int i = 0; i < core::StoredMeshes::Count; i++) {
+        loadStoredMesh(resourcesRoot + core::StoredMeshes::Filename(i), core::StoredMeshes::NAMES[i], meshes);
+    }
+
+    meshes.push_back(proceduralSphere(SPHERE_RINGS, SPHERE_SEGMENTS));
+    meshes.push_back(proceduralTerrain(TERRAIN_SIZE));
+    std::ofstream json(outputFilename.c_str());
+
+    if (!json.is_open()) {
+        std::cout << "ProgressiveMeshBenchmark " << "Couldn't open " << outputFilename << " for writing" << std::endl;
+        return 1;
+    }
+
+    json << "{\n    \"cpuCores\": " << core::ExecutionInfo::AVAILABLE_CPU_CORES << ",\n    \"results\": [";
+    bool first = true;
+
+    for (auto it = meshes.begin(); it != meshes.end(); ++it) {
+        benchmark(*it, utils::MelaxCurvature, "MelaxCurvature", json, first);
+        benchmark(*it, utils::QuadricErrorMetric, "QuadricErrorMetric", json, false);
+        first = false;
+    }
+
+    json << "\n    ]\n}\n";
+    std::cout << "ProgressiveMeshBenchmark " << "results written to " << outputFilename << std::endl;
+    return 0;
+}
@@ -1,7 +1,23 @@
 #include "MeshesCollection.h"
+#include "..\utils\ProgressiveMeshes.h"
+#include <algorithm>
+#include <cmath>
 using namespace collections;
 
-MeshesCollection::MeshesCollection(void)
+// faces no mesh goes below while budgeted
+static const unsigned int BUDGET_MIN_POLYCOUNT = 32;
+// balancing transfers per frame and their size relative to the giving mesh
+static const unsigned int BUDGET_TRANSFER_STEPS = 16;
+static const float BUDGET_TRANSFER_RATIO = 0.05f;
+// error gain needed for a transfer, avoids moving faces back and forth
+static const float BUDGET_TRANSFER_THRESHOLD = 1.2f;
+// relative difference between the drawn faces and the budget before rescaling,
+// levels land a few faces off their allocation and that shouldn't rescale
+static const float BUDGET_FIT_TOLERANCE = 0.01f;
+// default milliseconds per frame for background loads uploads
+static const float DEFAULT_LOAD_BUDGET = 4.0f;
+
+MeshesCollection::MeshesCollection(void) : triangleBudget(0), loadBudget(DEFAULT_LOAD_BUDGET)
 {
 }
 
@@ -22,9 +38,69 @@ scene::Mesh *collections::MeshesCollection::createMesh()
 
 scene::Mesh *collections::MeshesCollection::createMesh(const std::string &sFilename)
 {
-    this->meshes.push_back(new scene::Mesh());
-    this->meshes.back()->loadMesh(sFilename);
-    return this->meshes.back();
+    std::string key = scene::Mesh::assetKey(sFilename);
+    scene::Mesh *source = getAssetMesh(key);
+    scene::Mesh *newMesh = new scene::Mesh();
+    this->meshes.push_back(newMesh);
+
+    // a load still in the background can't be waited for here
+    if (source && source->getLoadStatus() == scene::Mesh::Loaded && newMesh->shareAsset(source)) { return newMesh; }
+
+    newMesh->loadMesh(sFilename);
+
+    // streams refine their own submeshes, they aren't shared
+    if (newMesh->getLoadStatus() == scene::Mesh::Loaded && !newMesh->isStreaming()) { this->assets[key] = newMesh; }
+
+    return newMesh;
+}
+
+scene::Mesh *collections::MeshesCollection::createMeshAsync(const std::string &sFilename)
+{
+    std::string key = scene::Mesh::assetKey(sFilename);
+    scene::Mesh *source = getAssetMesh(key);
+    scene::Mesh *newMesh = new scene::Mesh();
+    this->meshes.push_back(newMesh);
+
+    if (source && source->getLoadStatus() != scene::Mesh::LoadFailed && newMesh->shareAsset(source)) { return newMesh; }
+
+    newMesh->loadMeshAsync(sFilename);
+
+    if (newMesh->getLoadStatus() == scene::Mesh::Loading && !newMesh->isStreaming()) { this->assets[key] = newMesh; }
+
+    return newMesh;
+}
+
+scene::Mesh *collections::MeshesCollection::getAssetMesh(const std::string &sAssetKey) const
+{
+    auto it = this->assets.find(sAssetKey);
+    return it == this->assets.end() ? nullptr : it->second;
+}
+
+void collections::MeshesCollection::forgetAsset(scene::Mesh *mesh)
+{
+    for (auto it = this->assets.begin(); it != this->assets.end(); ++it) {
+        if (it->second != mesh) { continue; }
+
+        // any other mesh sharing the asset holds it from now on
+        auto holder = std::find_if(this->meshes.begin(), this->meshes.end(), [mesh](const scene::Mesh * other) {
+            return other != mesh && other->sharesAsset(mesh);
+        });
+
+        if (holder != this->meshes.end()) { it->second = *holder; }
+        else { this->assets.erase(it); }
+
+        return;
+    }
+}
+
+void collections::MeshesCollection::updateLoads()
+{
+    auto deadline = std::chrono::high_resolution_clock::now() + std::chrono::microseconds((long long)(this->loadBudget * 1000.0f));
+
+    // by index, load callbacks may create meshes
+    for (unsigned int i = 0; i < this->meshes.size(); i++) {
+        if (this->meshes[i]->getLoadStatus() == scene::Mesh::Loading) { this->meshes[i]->updateLoad(deadline); }
+    }
 }
 
 scene::Mesh *collections::MeshesCollection::getMesh(const unsigned int index)
@@ -38,6 +114,7 @@ void collections::MeshesCollection::removeMesh(const unsigned int index)
 {
     if (index >= this->meshes.size()) { return; }
 
+    forgetAsset(this->meshes[index]);
     this->meshes.erase(this->meshes.begin() + index);
 }
 
@@ -47,9 +124,101 @@ void collections::MeshesCollection::removeMesh(scene::Mesh *mesh)
 
     if (it == this->meshes.end()) { return; }
 
+    forgetAsset(mesh);
     this->meshes.erase(it);
 }
 
+void collections::MeshesCollection::distributeTriangleBudget()
+{
+    if (this->triangleBudget == 0) { return; }
+
+    this->budgetReductors.clear();
+    this->budgetAllocation.clear();
+    float allocated = 0.0f;
+
+    for (auto it = this->meshes.begin(); it != this->meshes.end(); ++it) {
+        if (!(*it)->isMeshReductionEnabled() || (*it)->getMeshReductor()->getOriginalPolyCount() == 0) { continue; }
+
+        // view dependent meshes refine by screen error instead
+        if ((*it)->getMeshReductor()->isViewDependent()) { continue; }
+
+        utils::MeshReductor *reductor = (*it)->getMeshReductor();
+        // meshes new to the budget start at their minimum, the rest at the faces they
+        // actually draw, which is what the budget has to hold
+        unsigned int polyCount = reductor->getBudgetPolyCount() == 0 ? std::min(BUDGET_MIN_POLYCOUNT, reductor->getOriginalPolyCount()) : reductor->getActualPolyCount();
+        this->budgetReductors.push_back(reductor);
+        this->budgetAllocation.push_back((float)polyCount);
+        allocated += (float)polyCount;
+    }
+
+    if (this->budgetReductors.empty()) { return; }
+
+    // seen from the screen the mesh error goes as coverage / faces, so moving
+    // faces between meshes pays off by the coverage / faces^2 difference
+    auto priority = [&](const unsigned int i) {
+        return (this->budgetReductors[i]->getScreenCoverage() + 1.0f) / (this->budgetAllocation[i] * this->budgetAllocation[i]);
+    };
+    auto lowerBound = [&](const unsigned int i) { return (float)std::min(BUDGET_MIN_POLYCOUNT, this->budgetReductors[i]->getOriginalPolyCount()); };
+    auto upperBound = [&](const unsigned int i) { return (float)this->budgetReductors[i]->getOriginalPolyCount(); };
+
+    // fit the last allocation to the budget scaling it, keeps the faces proportions
+    if (std::abs(allocated - (float)this->triangleBudget) > BUDGET_FIT_TOLERANCE * (float)this->triangleBudget) {
+        float minimum = 0.0f;
+
+        for (unsigned int i = 0; i < this->budgetAllocation.size(); i++) { minimum += lowerBound(i); }
+
+        float spare = std::max(0.0f, (float)this->triangleBudget - minimum);
+
+        if (allocated > minimum) {
+            float scale = spare / (allocated - minimum);
+
+            for (unsigned int i = 0; i < this->budgetAllocation.size(); i++) {
+                this->budgetAllocation[i] = std::min(upperBound(i), lowerBound(i) + (this->budgetAllocation[i] - lowerBound(i)) * scale);
+            }
+        } else {
+            // nothing to scale from yet, faces proportional to the coverage square
+            // root equalize coverage / faces^2 which is the balanced allocation
+            float weights = 0.0f;
+
+            for (unsigned int i = 0; i < this->budgetAllocation.size(); i++) { weights += std::sqrt(this->budgetReductors[i]->getScreenCoverage() + 1.0f); }
+
+            for (unsigned int i = 0; i < this->budgetAllocation.size(); i++) {
+                float share = spare * std::sqrt(this->budgetReductors[i]->getScreenCoverage() + 1.0f) / weights;
+                this->budgetAllocation[i] = std::min(upperBound(i), lowerBound(i) + share);
+            }
+        }
+    }
+
+    // coverage changes, move faces from the least to the most useful mesh
+    for (unsigned int step = 0; step < BUDGET_TRANSFER_STEPS; step++) {
+        int giver = -1, taker = -1;
+
+        for (unsigned int i = 0; i < this->budgetAllocation.size(); i++) {
+            if (this->budgetAllocation[i] > lowerBound(i) && (giver < 0 || priority(i) < priority(giver))) { giver = i; }
+
+            if (this->budgetAllocation[i] < upperBound(i) && (taker < 0 || priority(i) > priority(taker))) { taker = i; }
+        }
+
+        if (giver < 0 || taker < 0 || giver == taker || priority(taker) <= priority(giver) * BUDGET_TRANSFER_THRESHOLD) { break; }
+
+        float transfer = std::max(1.0f, this->budgetAllocation[giver] * BUDGET_TRANSFER_RATIO);
+        transfer = std::min(transfer, this->budgetAllocation[giver] - lowerBound(giver));
+        transfer = std::min(transfer, upperBound(taker) - this->budgetAllocation[taker]);
+        this->budgetAllocation[giver] -= transfer;
+        this->budgetAllocation[taker] += transfer;
+    }
+
+    // only meshes with a new allocation change level
+    for (unsigned int i = 0; i < this->budgetReductors.size(); i++) {
+        unsigned int polyCount = std::max(1u, (unsigned int)(this->budgetAllocation[i] + 0.5f));
+
+        if (polyCount == this->budgetReductors[i]->getBudgetPolyCount() || polyCount == this->budgetReductors[i]->getActualPolyCount()) { continue; }
+
+        this->budgetReductors[i]->setBudgetPolyCount(polyCount);
+        this->budgetReductors[i]->reducePolyCount(polyCount);
+    }
+}
+
 collections::MeshesCollection::~MeshesCollection()
 {
     this->meshes.clear();
@@ -1,5 +1,6 @@
 #pragma once
 #include "..\Scene\Mesh.h"
+#include <map>
 #include <utility>
 
 namespace collections {
@@ -8,19 +9,47 @@ namespace collections {
         private:
             static MeshesCollection *instance;
             std::vector <scene::Mesh *> meshes;
+            // a mesh holding each loaded asset by scene::Mesh::assetKey, new meshes share it
+            std::map<std::string, scene::Mesh *> assets;
+            // faces per frame shared by the meshes with reduction enabled, 0 disables it
+            unsigned int triangleBudget;
+            // milliseconds per frame spent uploading background loads
+            float loadBudget;
+            // reused by distributeTriangleBudget
+            std::vector<utils::MeshReductor *> budgetReductors;
+            std::vector<float> budgetAllocation;
             MeshesCollection(void);
             MeshesCollection(const MeshesCollection &meshesColl);
 
         public:
             ~MeshesCollection();
             static MeshesCollection *Instance();
+            // meshes from an asset already loaded share its geometry and materials
             scene::Mesh *createMesh(const std::string &sFilename);
             scene::Mesh *createMesh();
+            // the mesh is empty until its background load is uploaded, see scene::Mesh::loadMeshAsync,
+            // an asset already loading is loaded once and shared
+            scene::Mesh *createMeshAsync(const std::string &sFilename);
+            // mesh holding the asset, nullptr if none is loaded or loading
+            scene::Mesh *getAssetMesh(const std::string &sAssetKey) const;
+            // other meshes stop sharing the mesh geometry, when it is removed or reduced
+            void forgetAsset(scene::Mesh *mesh);
             scene::Mesh *getMesh(const unsigned int index);
             void removeMesh(const unsigned int index);
             void removeMesh(scene::Mesh *mesh);
             unsigned int meshCount() const { return meshes.size(); }
             const std::vector<scene::Mesh *> &getMeshes() const { return meshes; }
+            void setTriangleBudget(const unsigned int val) { triangleBudget = val; }
+            unsigned int getTriangleBudget() const { return triangleBudget; }
+            // updates last frame allocation of the triangle budget with the current meshes
+            // screen coverage, faces move from the meshes where they reduce the error least
+            // to where they reduce it most, only a few steps per frame
+            void distributeTriangleBudget();
+            void setLoadBudget(const float val) { loadBudget = val; }
+            float getLoadBudget() const { return loadBudget; }
+            // uploads the meshes background loads until the load budget runs out, every
+            // loading mesh gets at least one step, gl thread only, once per frame
+            void updateLoads();
     };
 }
 
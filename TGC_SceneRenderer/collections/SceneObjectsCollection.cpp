@@ -100,7 +100,8 @@ scene::Mesh *collections::SceneObjectsCollection::addMeshFromFile(const std::str
 {
     objectsIndex++;
     scene::SceneObject *newObject = new scene::SceneObject();
-    scene::Mesh *newMesh = collections::MeshesCollection::Instance()->createMesh(sMeshFilename);
+    // returns right away, the mesh fills in while its load is uploaded each frame
+    scene::Mesh *newMesh = collections::MeshesCollection::Instance()->createMeshAsync(sMeshFilename);
     newObject->setBaseObject(newMesh->base);
     newObject->addComponent(newMesh);
     this->sceneObjects[objectsIndex] = newObject;
@@ -21,6 +21,7 @@ namespace collections {
             scene::Light *addLight(scene::Light::LightType lightType);
             scene::Mesh *addMesh(const std::string &sMeshname);
             scene::Mesh *addMesh(const core::StoredMeshes::Meshes meshId);
+            // the mesh loads in the background, see scene::Mesh::getLoadStatus
             scene::Mesh *addMeshFromFile(const std::string &sMeshFilename);
             scene::SceneObject *getSceneObject(const unsigned int &index);
             const std::unordered_map<unsigned int, scene::SceneObject *> &getSceneObjects() const { return sceneObjects; }
@@ -20,7 +20,7 @@ TexturesCollection::~TexturesCollection()
     deleteAllTextures();
 }
 
-types::Texture *TexturesCollection::addTexture(const std::string &sFilename, types::Texture::TextureType textureType)
+types::Texture *TexturesCollection::addTexture(const std::string &sFilename, types::Texture::TextureType textureType, FIBITMAP *image /* = nullptr */)
 {
     if (preventDuplicates) {
         for (auto it = this->textures.begin(); it != this->textures.end(); it++) {
@@ -34,7 +34,8 @@ types::Texture *TexturesCollection::addTexture(const std::string &sFilename, typ
     }
 
     types::Texture *newTex = new types::Texture(sFilename, idCounter, textureType);
-    bool loadingResult = newTex->loadTexture();
+    // decoded already, only the upload is left
+    bool loadingResult = image ? newTex->loadTexture(image) : newTex->loadTexture();
 
     if (!loadingResult) {
         std::cout << "Textures(" << this << "): " << "Error loading " << sFilename << " texture" << std::endl;
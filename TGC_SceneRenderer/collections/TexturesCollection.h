@@ -15,8 +15,9 @@ namespace collections {
             virtual ~TexturesCollection();
             // creates Unique Static Instance
             static TexturesCollection *Instance();
-            // loads a new texture
-            types::Texture *addTexture(const std::string &sFilename, types::Texture::TextureType textureType);
+            // loads a new texture, from image if the file was already decoded, see
+            // types::Texture::decodeImage, the image stays owned by the caller
+            types::Texture *addTexture(const std::string &sFilename, types::Texture::TextureType textureType, FIBITMAP *image = nullptr);
             // unloads texture from gpu memory and reference
             bool unloadTexture(const unsigned int &texID);
             // unloads texture from gpu memory and reference and frees texture
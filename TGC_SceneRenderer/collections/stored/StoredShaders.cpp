@@ -36,6 +36,32 @@ void collections::stored::StoredShaders::LoadShaders()
         // add shaderprogram to class storage vector
         shaders[i] = shp;
     }
+
+    // compute programs need a gl 4.3 context
+    if (!core::EngineData::ComputeShadersAvailable()) { return; }
+
+    computeShaders.resize(core::StoredShaders::ComputeCount);
+
+    for (int i = 0; i < core::StoredShaders::ComputeCount; i++) {
+        types::ShaderProgram *shp = new types::ShaderProgram();
+        types::Shader *comp = new types::Shader(types::Shader::Compute);
+        comp->loadFromFile(core::StoredShaders::Filename((core::StoredShaders::ComputeShaders)i));
+        comp->compile();
+        shp->attachShader(comp);
+
+        // unusable programs stay out, callers fall back to their cpu path
+        if (!shp->link()) {
+            delete shp;
+            shp = nullptr;
+        } else {
+            // level generation uniforms
+            shp->addUniform(core::ShadersData::Uniforms::LEVEL_VERTEX_COUNT_NAME);
+            shp->addUniform(core::ShadersData::Uniforms::LEVEL_FACE_COUNT_NAME);
+            shp->addUniform(core::ShadersData::Uniforms::LEVEL_BASE_FACE_NAME);
+        }
+
+        computeShaders[i] = shp;
+    }
 }
 
 types::ShaderProgram *collections::stored::StoredShaders::getStoredShader(const core::StoredShaders::Shaders &sh)
@@ -45,6 +71,13 @@ types::ShaderProgram *collections::stored::StoredShaders::getStoredShader(const
     return shaders[sh];
 }
 
+types::ShaderProgram *collections::stored::StoredShaders::getStoredShader(const core::StoredShaders::ComputeShaders &sh)
+{
+    if (computeShaders.empty()) { return nullptr; }
+
+    return computeShaders[sh];
+}
+
 void collections::stored::StoredShaders::Clear()
 {
     for (auto it = shaders.begin(); it != shaders.end(); ++it) {
@@ -52,6 +85,12 @@ void collections::stored::StoredShaders::Clear()
     }
 
     shaders.clear();
+
+    for (auto it = computeShaders.begin(); it != computeShaders.end(); ++it) {
+        delete *it;
+    }
+
+    computeShaders.clear();
 }
 
 void collections::stored::StoredShaders::AddShaderData(types::ShaderProgram *shp)
@@ -67,6 +106,10 @@ void collections::stored::StoredShaders::AddShaderData(types::ShaderProgram *shp
     for (int i = 0; i < core::ShadersData::Structures::MATERIAL_MEMBER_COUNT; i++) {
         shp->addUniform(std::string(core::ShadersData::Uniforms::MATERIAL_INSTANCE_NAME) + "." + std::string(core::ShadersData::Structures::MATERIAL_MEMBER_NAMES[i]));
     }
+
+    // progressive meshes geomorphing blend
+    shp->addUniform(core::ShadersData::Uniforms::GEOMORPH_FACTOR_NAME);
 }
 
 std::vector<types::ShaderProgram *> collections::stored::StoredShaders::shaders;
+std::vector<types::ShaderProgram *> collections::stored::StoredShaders::computeShaders;
@@ -11,6 +11,7 @@ namespace collections {
             private:
 
                 static std::vector<types::ShaderProgram *> shaders;
+                static std::vector<types::ShaderProgram *> computeShaders;
                 static void AddShaderData(types::ShaderProgram *shp);
 
             public:
@@ -18,6 +19,8 @@ namespace collections {
                 static void LoadShaders();
                 static void Clear();
                 static types::ShaderProgram *getStoredShader(const core::StoredShaders::Shaders &sh);
+                // nullptr if compute shaders aren't available
+                static types::ShaderProgram *getStoredShader(const core::StoredShaders::ComputeShaders &sh);
 
         };
     }
@@ -8,6 +8,8 @@
 #include "..\collections\LightsCollection.h"
 #include "..\collections\MeshesCollection.h"
 #include "Data.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <thread>
 #include "..\Types\Texture.h"
@@ -23,6 +25,11 @@ const char *core::ShadersData::UniformBlocks::SHAREDMATRICES_NAME = "sharedMatri
 
 const char *core::ShadersData::Uniforms::MATERIAL_INSTANCE_NAME = "material";
 
+const char *core::ShadersData::Uniforms::GEOMORPH_FACTOR_NAME = "geomorphFactor";
+const char *core::ShadersData::Uniforms::LEVEL_VERTEX_COUNT_NAME = "levelVertexCount";
+const char *core::ShadersData::Uniforms::LEVEL_FACE_COUNT_NAME = "levelFaceCount";
+const char *core::ShadersData::Uniforms::LEVEL_BASE_FACE_NAME = "levelBaseFace";
+
 const char *core::ShadersData::DATA_FILENAME = "/resources/shaders/shared_data.glsl";
 
 const char *core::ShadersData::FUNCTIONS_FILENAME =  "/resources/shaders/shared_functions.glsl";
@@ -125,6 +132,10 @@ const char *core::StoredShaders::FILENAMES[] = {
     "/resources/shaders/utility/depth",
 };
 
+const char *core::StoredShaders::COMPUTE_FILENAMES[] = {
+    "/resources/shaders/utility/collapse_indices",
+};
+
 const std::string core::StoredShaders::Filename(const Shaders &index, const unsigned int &type)
 {
     std::string extension = ".";
@@ -146,6 +157,11 @@ const std::string core::StoredShaders::Filename(const Shaders &index, const unsi
     return ExecutionInfo::EXEC_DIR + FILENAMES[index] + extension;
 }
 
+const std::string core::StoredShaders::Filename(const ComputeShaders &index)
+{
+    return ExecutionInfo::EXEC_DIR + COMPUTE_FILENAMES[index] + ".comp";
+}
+
 const std::string core::StoredMeshes::Filename(const unsigned int &index)
 {
     return ExecutionInfo::EXEC_DIR + FILENAMES[index];
@@ -206,6 +222,7 @@ void core::Data::Initialize()
         }
     }
 
+    EngineData::computeShadersAvailable = ogl_IsVersionGEQ(4, 3) != 0;
     // Load Execution Location Info - WIN only
     const std::string &execDirRef = core::ExecutionInfo::EXEC_DIR;
     // Obtain Execution Directory
@@ -262,6 +279,29 @@ const std::string core::ExecutionInfo::EXEC_DIR = "";
 
 unsigned const int core::ExecutionInfo::AVAILABLE_CPU_CORES = std::thread::hardware_concurrency() <= 0 ? 1 : std::thread::hardware_concurrency();
 
+// threads spawned through TakeWorkers and not released yet
+static std::atomic<unsigned int> workersInUse(0);
+
+unsigned int core::ExecutionInfo::TakeWorkers(const unsigned int wanted)
+{
+    const unsigned int spawnable = AVAILABLE_CPU_CORES - 1;
+    unsigned int inUse = workersInUse.load();
+    unsigned int taken = 0;
+
+    do {
+        taken = std::min(wanted, spawnable > inUse ? spawnable - inUse : 0);
+    } while (!workersInUse.compare_exchange_weak(inUse, inUse + taken));
+
+    return taken;
+}
+
+void core::ExecutionInfo::ReleaseWorkers(const unsigned int count)
+{
+    workersInUse -= count;
+}
+
 bool core::EngineData::anisotropicFilteringAvailable = false;
 
 GLfloat core::EngineData::maxAnisotropicFiltering = (GLfloat)0.0f;
+
+bool core::EngineData::computeShadersAvailable = false;
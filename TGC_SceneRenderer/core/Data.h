@@ -23,6 +23,11 @@ namespace core {
         public:
             static const unsigned int AVAILABLE_CPU_CORES;
             static const std::string EXEC_DIR;
+            // up to wanted threads to spawn from the cores the threads in flight leave, shared
+            // by the imports, the progressive mesh generation and the baker, the calling
+            // threads aren't counted, each taken thread goes back with ReleaseWorkers
+            static unsigned int TakeWorkers(const unsigned int wanted);
+            static void ReleaseWorkers(const unsigned int count);
     };
 
     class EngineData {
@@ -31,12 +36,15 @@ namespace core {
 
             static bool anisotropicFilteringAvailable;
             static GLfloat maxAnisotropicFiltering;
+            static bool computeShadersAvailable;
             friend void core::Data::Initialize();
 
         public:
 
             static bool AnisotropicFilteringAvaible() { return anisotropicFilteringAvailable; }
             static float MaxAnisotropicFilteringAvaible() { return (float)maxAnisotropicFiltering; }
+            // gl 4.3 context, compute shaders and indirect draws
+            static bool ComputeShadersAvailable() { return computeShadersAvailable; }
 
             class Commoms {
                 public:
@@ -80,6 +88,10 @@ namespace core {
             class Uniforms {
                 public:
                     static const char *MATERIAL_INSTANCE_NAME;
+                    static const char *GEOMORPH_FACTOR_NAME;
+                    static const char *LEVEL_VERTEX_COUNT_NAME;
+                    static const char *LEVEL_FACE_COUNT_NAME;
+                    static const char *LEVEL_BASE_FACE_NAME;
             };
 
             // Shaders Uniform Blocks
@@ -140,9 +152,17 @@ namespace core {
                 Count // not a shader, represents the number of available shaders
             };
 
+            // compute only programs, loaded if compute shaders are available
+            enum ComputeShaders {
+                CollapseIndices,
+                ComputeCount // not a shader, represents the number of available compute shaders
+            };
+
             static const std::string Filename(const Shaders &index, const unsigned int &type);
+            static const std::string Filename(const ComputeShaders &index);
         private:
             static const char *FILENAMES[];
+            static const char *COMPUTE_FILENAMES[];
     };
 
     class StoredMeshes {
@@ -76,6 +76,8 @@ layout(std140) uniform sharedShadowing {
 
 // Common Uniforms Variables
 uniform Material material;
+// blend from vertexPosition to vertexMorphTarget
+uniform float geomorphFactor;
 
 // type identifiers
 const uint LIGHT_POINT       = 0;
@@ -8,6 +8,7 @@ layout(location = 1) in vec2 vertexTexCoords;
 layout(location = 2) in vec3 vertexNormal;
 layout(location = 3) in vec3 vertexTangent;
 layout(location = 4) in vec3 vertexBitangent;
+layout(location = 5) in vec3 vertexMorphTarget;
 // Vertex shader ouput data
 out vec2 texCoord;
 out vec3 normal;
@@ -23,7 +24,7 @@ out vec4 shadowCoord[MAX_SHADOWS];
 
 void main()
 {
-	vec4 vertexPos = vec4(vertexPosition, 1.0f);
+	vec4 vertexPos = vec4(mix(vertexPosition, vertexMorphTarget, geomorphFactor), 1.0f);
 
 	texCoord = vertexTexCoords;
 	normal = normalize((matrix.normal * vec4(vertexNormal, 0.0f)).xyz);
@@ -6,6 +6,7 @@
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec2 vertexTexCoords;
 layout(location = 2) in vec3 vertexNormal;
+layout(location = 5) in vec3 vertexMorphTarget;
 // Vertex shader ouput data
 out vec2 texCoord;
 out vec3 normal;
@@ -17,7 +18,7 @@ out vec4 shadowCoord[MAX_SHADOWS];
 
 void main()
 {
-	vec4 vertexPos = vec4(vertexPosition, 1.0f);
+	vec4 vertexPos = vec4(mix(vertexPosition, vertexMorphTarget, geomorphFactor), 1.0f);
 
 	texCoord = vertexTexCoords;
 	normal = normalize((matrix.normal * vec4(vertexNormal, 0.0f)).xyz);
@@ -4,7 +4,8 @@
 
 // Input vertex data
 layout(location = 0) in vec3 vertexPosition;
+layout(location = 5) in vec3 vertexMorphTarget;
 
 void main() {
-	gl_Position = matrix.modelViewProjection * vec4(vertexPosition, 1.0f);
+	gl_Position = matrix.modelViewProjection * vec4(mix(vertexPosition, vertexMorphTarget, geomorphFactor), 1.0f);
 }
\ No newline at end of file
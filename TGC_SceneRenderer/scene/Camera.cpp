@@ -1,6 +1,7 @@
 #include "Camera.h"
 #include "..\Core\Engine.h"
 #include "..\collections\MeshesCollection.h"
+#include "..\utils\ProgressiveMeshes.h"
 using namespace scene;
 
 Camera::Camera(void)
@@ -120,6 +121,20 @@ void scene::Camera::setEyeSeparation(const float val)
 
 void scene::Camera::render(const core::Engine *engine)
 {
+    // streamed geometry, background loads and reductions are uploaded before any pass draws
+    engine->meshes->updateLoads();
+
+    for (unsigned int i = 0; i < engine->meshes->meshCount(); i++) {
+        scene::Mesh *mesh = engine->meshes->getMesh(i);
+        mesh->updateStream();
+
+        if (!mesh->isMeshReductionEnabled()) { continue; }
+
+        mesh->getMeshReductor()->applyPendingReduction();
+        // after the view level, the shadow level is never finer than it
+        mesh->getMeshReductor()->reduceShadowCasters();
+    }
+
     if (scene::Light::getShadowCount() >= 0) {
         // get all the available shadow projectors
         const std::array<utils::ShadowMapping *, core::EngineData::Constrains::MAX_SHADOWMAPS> &shadowProjectors = scene::Light::getShadowProjectors();
@@ -227,6 +242,21 @@ void scene::Camera::renderMeshes(const core::Engine *engine)
 {
     // get all the available shadow projectors, if shadowing is enabled we need to update the model matrix per model
     const std::array<utils::ShadowMapping *, core::EngineData::Constrains::MAX_SHADOWMAPS> &shadowProjectors = scene::Light::getShadowProjectors();
+    const bool triangleBudget = engine->meshes->getTriangleBudget() > 0;
+
+    // the frame triangle budget needs every mesh screen coverage before drawing
+    if (triangleBudget) {
+        for (unsigned int i = 0; i < engine->meshes->meshCount(); i++) {
+            scene::Mesh *mesh = engine->meshes->getMesh(i);
+
+            if (!mesh->isMeshReductionEnabled()) { continue; }
+
+            float radius = std::min(this->projectedRadius(mesh), this->width + this->height);
+            mesh->getMeshReductor()->setScreenCoverage(std::min(glm::pi<float>() * radius * radius, this->width * this->height));
+        }
+
+        engine->meshes->distributeTriangleBudget();
+    }
 
     for (unsigned int i = 0; i < engine->meshes->meshCount(); i++) {
         // set model view matrix per mesh
@@ -252,9 +282,57 @@ void scene::Camera::renderMeshes(const core::Engine *engine)
             }
         }
 
+        scene::Mesh *mesh = engine->meshes->getMesh(i);
+
+        // view dependent refinement from the camera position in the mesh model space,
+        // otherwise automatic level of detail based on the mesh screen size
+        if (mesh->isMeshReductionEnabled() && mesh->getMeshReductor()->isViewDependent()) {
+            glm::vec3 viewPoint = glm::vec3(glm::inverse(mesh->base->transform.getModelMatrix()) * glm::vec4(this->base->transform.position, 1.0f));
+            mesh->getMeshReductor()->refineForView(viewPoint, this->pixelsPerUnit(mesh), this->projectionType != Orthographic);
+        } else if (!triangleBudget && mesh->isMeshReductionEnabled() && mesh->getMeshReductor()->isAutomaticReduction()) {
+            mesh->getMeshReductor()->reduceByScreenSize(this->projectedRadius(mesh));
+        }
+
         // finally call glDraw with mesh data
-        engine->meshes->getMesh(i)->render();
+        mesh->render();
+    }
+}
+
+float scene::Camera::projectedRadius(scene::Mesh *mesh) const
+{
+    types::Transform &transform = mesh->base->transform;
+    glm::vec3 scale = glm::abs(transform.scale);
+    // world space bounding sphere from the mesh bounds
+    float radius = glm::length(mesh->getMaxPoint() - mesh->getMinPoint()) * 0.5f * std::max(scale.x, std::max(scale.y, scale.z));
+    glm::vec3 center = glm::vec3(transform.getModelMatrix() * glm::vec4(mesh->getMidPoint(), 1.0f));
+    // half viewport height at unit distance
+    float halfHeight = glm::tan(glm::radians(this->fieldOfView) * 0.5f);
+
+    if (this->projectionType == Orthographic) {
+        return radius / (halfHeight * this->nearClippingPlane * this->orthoProjectionVerticalSize) * this->height * 0.5f;
+    }
+
+    float distance = glm::length(center - this->base->transform.position);
+
+    // camera inside the sphere, covers the whole viewport
+    if (distance <= radius) { return std::numeric_limits<float>::max(); }
+
+    return radius / (std::sqrt(distance * distance - radius * radius) * halfHeight) * this->height * 0.5f;
+}
+
+float scene::Camera::pixelsPerUnit(scene::Mesh *mesh) const
+{
+    // half viewport height at unit distance
+    float halfHeight = glm::tan(glm::radians(this->fieldOfView) * 0.5f);
+
+    // model space lengths project the same at any distance, scaled by the model
+    if (this->projectionType == Orthographic) {
+        glm::vec3 scale = glm::abs(mesh->base->transform.scale);
+        return std::max(scale.x, std::max(scale.y, scale.z)) / (halfHeight * this->nearClippingPlane * this->orthoProjectionVerticalSize) * this->height * 0.5f;
     }
+
+    // the scale cancels out with the model space distance
+    return this->height * 0.5f / halfHeight;
 }
 
 glm::vec3 scene::Camera::getCameraTarget() const
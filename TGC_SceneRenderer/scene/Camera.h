@@ -16,6 +16,8 @@ namespace core {
 
 namespace scene {
 
+    class Mesh;
+
     class Camera : public bases::BaseComponent {
         protected:
 
@@ -42,6 +44,8 @@ namespace scene {
             glm::vec3 getCameraTarget() const;
 
             void renderMeshes(const core::Engine *engine);
+            // pixels covered by a mesh model space length, at unit distance if perspective
+            float pixelsPerUnit(scene::Mesh *mesh) const;
 
         public:
 
@@ -94,6 +98,8 @@ namespace scene {
             void viewport();
             // calculates eye separation based on zero parallax, 3.5% * widthZp
             void calculateEyeSeparation();
+            // radius in pixels of the mesh bounding sphere projected on the viewport
+            float projectedRadius(scene::Mesh *mesh) const;
     };
 }
 
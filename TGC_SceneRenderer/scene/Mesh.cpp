@@ -1,157 +1,734 @@
 #include "Mesh.h"
 #include "..\core\Data.h"
 #include "..\utils\ProgressiveMeshes.h"
+#include "..\utils\ProgressiveMeshStream.h"
+#include "..\utils\AsyncMeshLoad.h"
 #include "..\collections\MeshesCollection.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 using namespace scene;
 
-Mesh::Mesh(void) : polyCount(0), vertexCount(0), meshReductionEnabled(false)
+// faces per level compute dispatch, 65535 work groups of 64 invocations
+static const unsigned int MAX_DISPATCH_FACES = 65535 * 64;
+const unsigned int scene::Mesh::IMPORT_FLAGS = aiProcessPreset_TargetRealtime_Quality;
+
+Mesh::Mesh(void) : polyCount(0), vertexCount(0), loadStatus(NotLoaded), asset(nullptr), uniqueMeshEntries(false), residency(KeepAll), meshReductionEnabled(false)
 {
     texCollection = collections::TexturesCollection::Instance();
     this->base = new bases::BaseObject("Mesh");
     this->meshReductor = nullptr;
+    this->stream = nullptr;
+    this->asyncLoad = nullptr;
 }
 
 Mesh::~Mesh(void)
 {
-    for (auto it = materials.begin(); it != materials.end(); it++) {
-        delete *it;
+    // first, another mesh sharing the asset takes its place in the collection
+    collections::MeshesCollection::Instance()->removeMesh(this);
+    // stops the reduction worker before the submeshes it reads go away
+    if (this->meshReductionEnabled) { delete this->meshReductor; this->meshReductor = nullptr; }
+
+    // stops the stream reader before the submeshes it writes go away
+    delete this->stream;
+    // cancels a background import, waits for the step it is in, see utils::AsyncMeshLoad
+    delete this->asyncLoad;
+
+    // shared materials and submeshes go with the last mesh sharing them
+    if (!this->asset) {
+        for (auto it = materials.begin(); it != materials.end(); it++) {
+            delete *it;
+        }
     }
 
     materials.clear();
 
-    for (auto it = meshEntries.begin(); it != meshEntries.end(); it++) {
-        delete *it;
+    if (!this->asset || this->uniqueMeshEntries) {
+        for (auto it = meshEntries.begin(); it != meshEntries.end(); it++) {
+            delete *it;
+        }
     }
 
     meshEntries.clear();
+    releaseAsset();
+}
 
-    if (this->meshReductionEnabled) { delete this->meshReductor; }
+bool Mesh::loadMesh(const std::string &sFileName, const bool geometryOnly /* = false */)
+{
+    // progressive streams draw before the whole file arrives
+    if (utils::ProgressiveMeshStream::isStreamFile(sFileName)) { return loadProgressiveStream(sFileName); }
 
-    collections::MeshesCollection::Instance()->removeMesh(this);
+    this->filepath = sFileName; bool bRtrn = false;
+    std::vector<utils::CookedMesh::MaterialData> materialsData;
+
+    // an up to date cooked import skips assimp
+    if (loadCooked(sFileName, geometryOnly, materialsData)) {
+        std::cout << "Mesh(" << this << ") " << "Asset " << sFileName << " loaded from " << utils::CookedMesh::cookedFilename(sFileName) << std::endl;
+        finishLoad(true);
+        return true;
+    }
+
+    bRtrn = importScene(sFileName, materialsData, geometryOnly);
+
+    if (bRtrn) { std::cout << "Mesh(" << this << ") " << "Asset " << sFileName << " loaded successfully" << std::endl; }
+    else { std::cout << "Mesh(" << this << ") " << "An error occured loading asset " << sFileName << std::endl; }
+
+    finishLoad(bRtrn);
+    return bRtrn;
 }
 
-bool Mesh::loadMesh(const std::string &sFileName)
+bool scene::Mesh::importScene(const std::string &sFileName, std::vector<utils::CookedMesh::MaterialData> &materialsData, const bool geometryOnly,
+                              const std::atomic<bool> *cancelled /* = nullptr */)
 {
-    this->filepath = sFileName; bool bRtrn = false;
+    bool bRtrn = false;
     Assimp::Importer Importer;
     // read filename with assimp importer
-    const aiScene *pScene = Importer.ReadFile(sFileName.c_str(), aiProcessPreset_TargetRealtime_Quality);
+    const aiScene *pScene = Importer.ReadFile(sFileName.c_str(), IMPORT_FLAGS);
+
+    // the read can't be interrupted, the conversion and the cooking are skipped
+    if (pScene && cancelled && *cancelled) { return false; }
 
     if (pScene) {
         std::cout << "Mesh(" << this << ") " << "Loading asset " << sFileName << std::endl;
         this->filename = pScene->mRootNode->mName.C_Str();
         this->fileExtension = this->filename.substr(filename.find_last_of(".") + 1);
-        bRtrn = initFromScene(pScene, sFileName);
+        readMaterials(pScene, materialsData);
+        bRtrn = initFromScene(pScene, sFileName, materialsData, geometryOnly);
+        // the materials data is read even for geometry only loads, both can cook
+        saveCooked(sFileName, materialsData);
     } else {
         std::cout << "Mesh(" << this << ") " << "Error parsing '" << sFileName << "': '" << Importer.GetErrorString() << std::endl;
     }
 
-    if (bRtrn) { std::cout << "Mesh(" << this << ") " << "Asset " << sFileName << " loaded successfully" << std::endl; }
-    else { std::cout << "Mesh(" << this << ") " << "An error occured loading asset " << sFileName << std::endl; }
-
     return bRtrn;
 }
 
-bool Mesh::initFromScene(const aiScene *pScene, const std::string &sFilename)
+bool scene::Mesh::importAsset(const std::string &sFileName, std::vector<utils::CookedMesh::MaterialData> &materialsData, const std::atomic<bool> *cancelled /* = nullptr */)
+{
+    this->filepath = sFileName;
+    return loadCooked(sFileName, true, materialsData) || importScene(sFileName, materialsData, true, cancelled);
+}
+
+bool scene::Mesh::loadMeshAsync(const std::string &sFileName)
+{
+    if (utils::ProgressiveMeshStream::isStreamFile(sFileName)) { return loadProgressiveStream(sFileName); }
+
+    if (this->asyncLoad || this->stream || !this->meshEntries.empty()) { return false; }
+
+    this->filepath = sFileName;
+    this->asyncLoad = new utils::AsyncMeshLoad();
+    this->asyncLoad->start(sFileName);
+    this->loadStatus = Loading;
+    std::cout << "Mesh(" << this << ") " << "Loading asset " << sFileName << " in the background" << std::endl;
+    return true;
+}
+
+void scene::Mesh::updateLoad(const std::chrono::high_resolution_clock::time_point &deadline)
+{
+    if (!this->pendingAssetKey.empty()) {
+        Mesh *source = collections::MeshesCollection::Instance()->getAssetMesh(this->pendingAssetKey);
+
+        // every mesh holding the asset went away, loads it itself
+        if (!source) { this->pendingAssetKey.clear(); this->loadStatus = NotLoaded; loadMeshAsync(this->filepath); }
+        else if (source->loadStatus == LoadFailed) { this->pendingAssetKey.clear(); finishLoad(false); }
+        else if (source->loadStatus == Loaded) { shareAsset(source); }
+
+        return;
+    }
+
+    if (!this->asyncLoad || !this->asyncLoad->isImported()) { return; }
+
+    Mesh *staging = this->asyncLoad->getStaging();
+
+    if (!this->asyncLoad->hasSucceeded()) {
+        std::cout << "Mesh(" << this << ") " << "An error occured loading asset " << this->filepath << std::endl;
+        delete this->asyncLoad; this->asyncLoad = nullptr;
+        finishLoad(false);
+        return;
+    }
+
+    const std::vector<utils::CookedMesh::MaterialData> &materialsData = this->asyncLoad->getMaterialsData();
+    std::string dirPlusSlash = assetDirectory(this->filepath);
+    bool foundTextures = false;
+
+    do {
+        // materials first, the worker decoded their textures so a step only uploads them,
+        // the staging mesh keeps them until every one is ready so no submesh draws with a
+        // missing material
+        if (this->asyncLoad->uploadedMaterials < materialsData.size()) {
+            const unsigned int index = this->asyncLoad->uploadedMaterials++;
+            const std::vector<std::vector<FIBITMAP *>> &images = this->asyncLoad->getImages();
+            staging->materials.push_back(initMaterial(materialsData[index], dirPlusSlash, foundTextures, index < images.size() ? &images[index] : nullptr));
+            continue;
+        }
+
+        if (this->asyncLoad->uploadedSubMeshes == 0) {
+            if (materialsData.empty()) { staging->materials.push_back(new types::Material()); staging->materials.back()->addTexture(texCollection->getDefaultTexture()); }
+
+            this->materials.swap(staging->materials);
+            this->filename = staging->filename;
+            this->fileExtension = staging->fileExtension;
+            this->maxPoint = staging->maxPoint;
+            this->minPoint = staging->minPoint;
+            this->midPoint = staging->midPoint;
+        }
+
+        if (this->asyncLoad->uploadedSubMeshes < staging->meshEntries.size()) {
+            // ownership moves to this mesh, it draws from the next frame on
+            SubMesh *subMesh = staging->meshEntries[this->asyncLoad->uploadedSubMeshes];
+            staging->meshEntries[this->asyncLoad->uploadedSubMeshes++] = nullptr;
+            subMesh->generateBuffers();
+            subMesh->setBuffersData();
+            this->meshEntries.push_back(subMesh);
+            this->vertexCount += subMesh->vertices.size();
+            this->polyCount += subMesh->indices.size() / 3;
+            continue;
+        }
+
+        std::cout << "Mesh(" << this << ") " << "Asset " << this->filepath << " loaded successfully" << std::endl;
+        staging->meshEntries.clear();
+        delete this->asyncLoad; this->asyncLoad = nullptr;
+        finishLoad(true);
+        return;
+    } while (std::chrono::high_resolution_clock::now() < deadline);
+}
+
+bool scene::Mesh::shareAsset(Mesh *source)
+{
+    if (!source || source == this || this->asset || this->asyncLoad || this->stream || !this->meshEntries.empty()) { return false; }
+
+    // waits for it, updateLoad shares it once loaded
+    if (source->loadStatus == Loading && !source->stream) {
+        this->filepath = source->filepath;
+        this->pendingAssetKey = assetKey(source->filepath);
+        this->loadStatus = Loading;
+        return true;
+    }
+
+    // reduced geometry isn't the asset anymore, unless it was copied from a shared one
+    if (source->loadStatus != Loaded || source->stream || (source->meshReductionEnabled && !source->asset)) { return false; }
+
+    if (!source->asset) {
+        source->asset = new SharedAsset();
+        source->asset->references = 1;
+        source->asset->meshEntries = source->meshEntries;
+        source->asset->materials = source->materials;
+        source->asset->vertexCount = source->vertexCount;
+        source->asset->polyCount = source->polyCount;
+        source->asset->residency = source->residency;
+    }
+
+    this->asset = source->asset;
+    this->asset->references++;
+    this->meshEntries = this->asset->meshEntries;
+    this->materials = this->asset->materials;
+    this->filepath = source->filepath;
+    this->filename = source->filename;
+    this->fileExtension = source->fileExtension;
+    this->maxPoint = source->maxPoint;
+    this->minPoint = source->minPoint;
+    this->midPoint = source->midPoint;
+    this->vertexCount = this->asset->vertexCount;
+    this->polyCount = this->asset->polyCount;
+    this->pendingAssetKey.clear();
+    finishLoad(true);
+    return true;
+}
+
+std::string scene::Mesh::assetKey(const std::string &sFileName)
+{
+    return sFileName + "|" + std::to_string(IMPORT_FLAGS);
+}
+
+void scene::Mesh::detachMeshEntries()
+{
+    if (!this->asset || this->uniqueMeshEntries) { return; }
+
+    for (auto it = this->meshEntries.begin(); it != this->meshEntries.end(); ++it) {
+        const SubMesh *shared = *it;
+        SubMesh *subMesh = new SubMesh();
+        subMesh->materialIndex = shared->materialIndex;
+        subMesh->maxPoint = shared->maxPoint;
+        subMesh->minPoint = shared->minPoint;
+        subMesh->midPoint = shared->midPoint;
+        subMesh->vertices = shared->vertices;
+        subMesh->indices = shared->indices;
+        subMesh->faces.reserve(shared->faces.size());
+
+        // faces point to the submesh own vertices
+        for (unsigned int i = 0; i + 2 < subMesh->indices.size(); i += 3) {
+            const unsigned int *face = &subMesh->indices[i];
+            subMesh->faces.push_back(types::Face(subMesh->vertices[face[0]], subMesh->vertices[face[1]], subMesh->vertices[face[2]], face[0], face[1], face[2]));
+        }
+
+        if (shared->VB != core::EngineData::Commoms::INVALID_VALUE) {
+            subMesh->generateBuffers();
+            subMesh->setBuffersData();
+        }
+
+        *it = subMesh;
+    }
+
+    this->uniqueMeshEntries = true;
+}
+
+void scene::Mesh::releaseAsset()
+{
+    if (!this->asset) { return; }
+
+    if (--this->asset->references == 0) {
+        for (auto it = this->asset->materials.begin(); it != this->asset->materials.end(); it++) {
+            delete *it;
+        }
+
+        for (auto it = this->asset->meshEntries.begin(); it != this->asset->meshEntries.end(); it++) {
+            delete *it;
+        }
+
+        delete this->asset;
+    }
+
+    this->asset = nullptr;
+}
+
+bool scene::Mesh::setResidency(const Residency residency)
 {
-    // Load associated materials
-    bool rtrn = initMaterials(pScene, sFilename);
+    if (residency == getResidency()) { return true; }
+
+    if (residency == KeepAll) { return restoreGeometry(); }
+
+    // reduction, streams and loads still write the submeshes
+    if (this->meshReductionEnabled || this->stream || this->asyncLoad || this->loadStatus != Loaded) { return false; }
+
+    // importAsset can't read a finished stream back, its geometry couldn't be restored
+    if (utils::ProgressiveMeshStream::isStreamFile(this->filepath)) { return false; }
+
+    // positions come from the vertices
+    if (residency == KeepPositions && getResidency() == KeepNone && !restoreGeometry()) { return false; }
+
+    size_t previousMemory = getCpuMemory();
+
+    for (auto it = this->meshEntries.begin(); it != this->meshEntries.end(); ++it) {
+        SubMesh *subMesh = *it;
+
+        if (residency == KeepPositions && !subMesh->vertices.empty()) {
+            subMesh->positions.resize(subMesh->vertices.size());
+
+            for (unsigned int i = 0; i < subMesh->vertices.size(); i++) { subMesh->positions[i] = subMesh->vertices[i].position; }
+        }
+
+        // swapped with empty vectors, clear keeps the storage
+        std::vector<types::Face>().swap(subMesh->faces);
+        std::vector<types::Vertex>().swap(subMesh->vertices);
+
+        if (residency == KeepNone) {
+            std::vector<glm::vec3>().swap(subMesh->positions);
+            std::vector<unsigned int>().swap(subMesh->indices);
+        }
+    }
+
+    if (this->asset) { this->asset->residency = residency; }
+    else { this->residency = residency; }
+
+    std::cout << "Mesh(" << this << ") " << "cpu geometry " << previousMemory / 1024 << "KB to " << getCpuMemory() / 1024 << "KB, gpu " << getGpuMemory() / 1024 << "KB" << std::endl;
+    return true;
+}
+
+bool scene::Mesh::restoreGeometry()
+{
+    if (getResidency() == KeepAll) { return true; }
+
+    // the same import the buffers were uploaded from, the cooked one unless it's gone
+    Mesh staging;
+    std::vector<utils::CookedMesh::MaterialData> materialsData;
+
+    if (!staging.importAsset(this->filepath, materialsData) || staging.meshEntries.size() != this->meshEntries.size()) {
+        std::cout << "Mesh(" << this << ") " << "Couldn't restore the cpu geometry of " << this->filepath << std::endl;
+        return false;
+    }
+
+    // the asset may have changed on disk since
+    for (unsigned int i = 0; i < this->meshEntries.size(); i++) {
+        if (staging.meshEntries[i]->vertices.size() != this->meshEntries[i]->vertexBufferCount ||
+                staging.meshEntries[i]->indices.size() != this->meshEntries[i]->indexBufferCount) {
+            std::cout << "Mesh(" << this << ") " << "Asset " << this->filepath << " changed, its cpu geometry can't be restored" << std::endl;
+            return false;
+        }
+    }
+
+    // swapping keeps the faces vertices pointers valid, staging deletes what was left
+    for (unsigned int i = 0; i < this->meshEntries.size(); i++) {
+        this->meshEntries[i]->vertices.swap(staging.meshEntries[i]->vertices);
+        this->meshEntries[i]->indices.swap(staging.meshEntries[i]->indices);
+        this->meshEntries[i]->faces.swap(staging.meshEntries[i]->faces);
+        std::vector<glm::vec3>().swap(this->meshEntries[i]->positions);
+    }
+
+    if (this->asset) { this->asset->residency = KeepAll; }
+    else { this->residency = KeepAll; }
+
+    std::cout << "Mesh(" << this << ") " << "cpu geometry restored from " << this->filepath << std::endl;
+    return true;
+}
+
+size_t scene::Mesh::getCpuMemory() const
+{
+    size_t memory = 0;
+
+    for (auto it = this->meshEntries.begin(); it != this->meshEntries.end(); ++it) { memory += (*it)->cpuMemory(); }
+
+    return memory;
+}
+
+size_t scene::Mesh::getGpuMemory() const
+{
+    size_t memory = 0;
+
+    for (auto it = this->meshEntries.begin(); it != this->meshEntries.end(); ++it) { memory += (*it)->gpuMemory(); }
+
+    return memory;
+}
+
+void scene::Mesh::setLoadCallback(const LoadCallback &callback)
+{
+    this->loadCallback = callback;
+
+    if (callback && (this->loadStatus == Loaded || this->loadStatus == LoadFailed)) { callback(this, this->loadStatus == Loaded); }
+}
+
+void scene::Mesh::finishLoad(const bool succeeded)
+{
+    this->loadStatus = succeeded ? Loaded : LoadFailed;
+
+    if (this->loadCallback) { this->loadCallback(this, succeeded); }
+}
+
+bool scene::Mesh::loadProgressiveStream(const std::string &sFileName)
+{
+    if (this->stream || !this->meshEntries.empty()) { return false; }
+
+    this->filepath = sFileName;
+    this->stream = new utils::ProgressiveMeshStream();
+
+    if (!this->stream->open(sFileName)) {
+        std::cout << "Mesh(" << this << ") " << "Error opening progressive stream " << sFileName << std::endl;
+        delete this->stream; this->stream = nullptr;
+        return false;
+    }
+
+    std::cout << "Mesh(" << this << ") " << "Streaming asset " << sFileName << std::endl;
+    this->loadStatus = Loading;
+    // the stream only holds geometry
+    materials.push_back(new types::Material()); materials.back()->addTexture(texCollection->getDefaultTexture());
+    return true;
+}
+
+void scene::Mesh::updateStream()
+{
+    if (!this->stream) { return; }
+
+    bool changed = this->stream->update(this->meshEntries);
+    const std::vector<utils::ProgressiveMeshStream::SubMeshInfo> &subMeshesInfo = this->stream->getSubMeshesInfo();
+
+    // the header brings the submeshes sizes and bounds, their base meshes may have arrived too
+    if (this->meshEntries.empty() && this->stream->hasHeader()) {
+        glm::vec3 maxPos(-std::numeric_limits<float>::infinity()); glm::vec3 minPos(std::numeric_limits<float>::infinity());
+
+        for (auto it = subMeshesInfo.begin(); it != subMeshesInfo.end(); ++it) {
+            SubMesh *newSubMesh = new SubMesh();
+            newSubMesh->materialIndex = 0;
+            newSubMesh->maxPoint = (*it).maxPoint;
+            newSubMesh->minPoint = (*it).minPoint;
+            newSubMesh->midPoint = ((*it).maxPoint + (*it).minPoint) / 2.0f;
+            newSubMesh->generateBuffers();
+            // splits only rewrite ranges of the full resolution storage
+            newSubMesh->reserveBuffers((*it).vertexCount, (*it).polyCount * 3);
+            this->meshEntries.push_back(newSubMesh);
+            maxPos = glm::max(maxPos, (*it).maxPoint);
+            minPos = glm::min(minPos, (*it).minPoint);
+        }
+
+        this->maxPoint = maxPos;
+        this->minPoint = minPos;
+        this->midPoint = (maxPos + minPos) / 2.0f;
+        changed = this->stream->update(this->meshEntries);
+    }
+
+    if (changed && this->meshEntries.size() == subMeshesInfo.size()) {
+        this->vertexCount = this->polyCount = 0;
+
+        for (unsigned int i = 0; i < this->meshEntries.size(); i++) {
+            SubMesh *subMesh = this->meshEntries[i];
+
+            if (subMeshesInfo[i].changedVertex < subMesh->vertices.size()) { subMesh->setVertexBufferSubData(subMesh->vertices, subMeshesInfo[i].changedVertex); }
+
+            if (subMeshesInfo[i].changedIndex < subMesh->indices.size()) { subMesh->setIndexBufferSubData(subMesh->indices, subMeshesInfo[i].changedIndex); }
+
+            this->vertexCount += subMeshesInfo[i].receivedVertices;
+            this->polyCount += subMeshesInfo[i].receivedFaces;
+        }
+    }
+
+    if (!this->stream->isComplete()) { return; }
+
+    // faces for mesh reduction, from the full resolution or the last level that arrived
+    for (auto it = this->meshEntries.begin(); it != this->meshEntries.end(); ++it) {
+        std::vector<types::Vertex> &vertices = (*it)->vertices;
+        const std::vector<unsigned int> &indices = (*it)->indices;
+        (*it)->faces.clear();
+
+        for (unsigned int i = 0; i + 2 < indices.size(); i += 3) {
+            (*it)->faces.push_back(types::Face(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], indices[i], indices[i + 1], indices[i + 2]));
+        }
+    }
+
+    if (this->stream->hasFailed()) { std::cout << "Mesh(" << this << ") " << "Stream " << this->filepath << " stopped at " << this->polyCount << " faces" << std::endl; }
+    else { std::cout << "Mesh(" << this << ") " << "Asset " << this->filepath << " streamed successfully" << std::endl; }
+
+    bool succeeded = !this->stream->hasFailed();
+    delete this->stream;
+    this->stream = nullptr;
+    finishLoad(succeeded);
+}
+
+bool Mesh::initFromScene(const aiScene *pScene, const std::string &sFilename, const std::vector<utils::CookedMesh::MaterialData> &materialsData, const bool geometryOnly)
+{
+    // Load associated materials, textures and shaders need gl
+    bool rtrn = geometryOnly ? pScene->mNumMeshes > 0 : initMaterials(materialsData, sFilename);
     glm::vec3 maxPos(-std::numeric_limits<float>::infinity()); glm::vec3 minPos(std::numeric_limits<float>::infinity());
+    const unsigned int subMeshCount = pScene->mNumMeshes;
+    // conversion only reads the scene and writes its own submesh, the biggest
+    // submeshes go first so no worker is left with a big one at the end
+    std::vector<unsigned int> order(subMeshCount);
 
-    // Initialize the meshes in the scene one by one
-    for (unsigned int i = 0; i < pScene->mNumMeshes; i++) {
-        // init submesh entry
-        this->meshEntries.push_back(initMesh(i, pScene->mMeshes[i]));
+    for (unsigned int i = 0; i < subMeshCount; i++) { order[i] = i; }
+
+    std::sort(order.begin(), order.end(), [pScene](const unsigned int a, const unsigned int b) {
+        return pScene->mMeshes[a]->mNumVertices + pScene->mMeshes[a]->mNumFaces > pScene->mMeshes[b]->mNumVertices + pScene->mMeshes[b]->mNumFaces;
+    });
+    std::vector<SubMesh *> subMeshes(subMeshCount, nullptr);
+    std::atomic<unsigned int> nextSubMesh(0);
+    auto conversionWorker = [&]() {
+        for (unsigned int i = nextSubMesh++; i < subMeshCount; i = nextSubMesh++) {
+            subMeshes[order[i]] = initMesh(order[i], pScene->mMeshes[order[i]]);
+        }
+    };
+    // the calling thread works too, the rest come from what other imports, generations
+    // or bakes in flight left, background loads run several imports at once
+    const unsigned int spawnedWorkers = core::ExecutionInfo::TakeWorkers(subMeshCount > 1 ? subMeshCount - 1 : 0);
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 0; i < spawnedWorkers; i++) {
+        workers.push_back(std::thread(conversionWorker));
+    }
+
+    conversionWorker();
+
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+        (*it).join();
+    }
+
+    core::ExecutionInfo::ReleaseWorkers(spawnedWorkers);
+
+    this->meshEntries.reserve(this->meshEntries.size() + subMeshCount);
+
+    // buffers and mesh totals on the calling (gl) thread, in scene order
+    for (auto it = subMeshes.begin(); it != subMeshes.end(); ++it) {
+        SubMesh *subMesh = *it;
+
+        if (!geometryOnly) {
+            subMesh->generateBuffers();
+            subMesh->setBuffersData();
+        }
+
+        this->meshEntries.push_back(subMesh);
+        this->vertexCount += subMesh->vertices.size();
+        this->polyCount += subMesh->faces.size();
         // set whole mesh scene center min max pos values
-        glm::vec3 subMeshMax = this->meshEntries.back()->maxPoint;
-        glm::vec3 subMeshMin = this->meshEntries.back()->minPoint;
-        maxPos.x = subMeshMax.x > maxPos.x ? subMeshMax.x : maxPos.x;
-        maxPos.y = subMeshMax.y > maxPos.y ? subMeshMax.y : maxPos.y;
-        maxPos.z = subMeshMax.z > maxPos.z ? subMeshMax.z : maxPos.z;
-        minPos.x = subMeshMin.x < minPos.x ? subMeshMin.x : minPos.x;
-        minPos.y = subMeshMin.y < minPos.y ? subMeshMin.y : minPos.y;
-        minPos.z = subMeshMin.z < minPos.z ? subMeshMin.z : minPos.z;
+        maxPos = glm::max(maxPos, subMesh->maxPoint);
+        minPos = glm::min(minPos, subMesh->minPoint);
     }
 
     this->maxPoint = maxPos;
     this->minPoint = minPos;
-    this->midPoint = glm::vec3((maxPos.x + minPos.x) / 2, (maxPos.y + minPos.y) / 2, (maxPos.z + minPos.z) / 2);
+    this->midPoint = (maxPos + minPos) / 2.0f;
     // return boolean value if any error occured during loading
     return rtrn;
 }
 
-Mesh::SubMesh *Mesh::initMesh(unsigned int index, const aiMesh *paiMesh)
+Mesh::SubMesh *Mesh::initMesh(unsigned int index, const aiMesh *paiMesh) const
 {
     SubMesh *newSubMesh = new SubMesh();
     newSubMesh->materialIndex = paiMesh->mMaterialIndex;
-    const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
-    aiVector3D maxPos(-std::numeric_limits<float>::infinity()), minPos(std::numeric_limits<float>::infinity());
-
-    for (unsigned int i = 0 ; i < paiMesh->mNumVertices ; i++) {
-        const aiVector3D *pPos      = &(paiMesh->mVertices[i]);
-        const aiVector3D *pNormal   = &(paiMesh->mNormals[i]);
-        const aiVector3D *pTexCoord = paiMesh->HasTextureCoords(0) ? &(paiMesh->mTextureCoords[0][i]) : &Zero3D;
-        const aiVector3D *pTangent =  paiMesh->HasTangentsAndBitangents() ? &paiMesh->mTangents[i] : &Zero3D;
-        const aiVector3D *pBitangent =  paiMesh->HasTangentsAndBitangents() ? &paiMesh->mBitangents[i] : &Zero3D;
-        types::Vertex v(
-            glm::vec3(pPos->x, pPos->y, pPos->z),
-            glm::vec2(pTexCoord->x, pTexCoord->y),
-            glm::vec3(pNormal->x, pNormal->y, pNormal->z),
-            glm::vec3(pTangent->x, pTangent->y, pTangent->z),
-            glm::vec3(pBitangent->x, pBitangent->y, pBitangent->z)
-        );
-        v.orthogonalize();
-        newSubMesh->vertices.push_back(v);
-        // set submesh center min max pos values
-        maxPos.x = pPos->x > maxPos.x ? pPos->x : maxPos.x;
-        maxPos.y = pPos->y > maxPos.y ? pPos->y : maxPos.y;
-        maxPos.z = pPos->z > maxPos.z ? pPos->z : maxPos.z;
-        minPos.x = pPos->x < minPos.x ? pPos->x : minPos.x;
-        minPos.y = pPos->y < minPos.y ? pPos->y : minPos.y;
-        minPos.z = pPos->z < minPos.z ? pPos->z : minPos.z;
-        // total mesh values
-        this->vertexCount++;
-    }
-
-    for (unsigned int i = 0 ; i < paiMesh->mNumFaces ; i++) {
+    const unsigned int vertexCount = paiMesh->mNumVertices;
+    const unsigned int faceCount = paiMesh->mNumFaces;
+    const bool hasTexCoords = paiMesh->HasTextureCoords(0);
+    const bool hasTangents = paiMesh->HasTangentsAndBitangents();
+    // outputs sized once, faces point into vertices so it can't reallocate after
+    std::vector<types::Vertex> &vertices = newSubMesh->vertices;
+    std::vector<unsigned int> &indices = newSubMesh->indices;
+    vertices.resize(vertexCount);
+    indices.resize(faceCount * 3);
+    newSubMesh->faces.reserve(faceCount);
+
+    // straight copies of the assimp arrays, branches hoisted out of the loops
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        const aiVector3D &pos = paiMesh->mVertices[i];
+        const aiVector3D &normal = paiMesh->mNormals[i];
+        vertices[i].position = glm::vec3(pos.x, pos.y, pos.z);
+        vertices[i].normal = glm::vec3(normal.x, normal.y, normal.z);
+    }
+
+    if (hasTexCoords) {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            const aiVector3D &texCoord = paiMesh->mTextureCoords[0][i];
+            vertices[i].texCoords = glm::vec2(texCoord.x, texCoord.y);
+        }
+    } else {
+        for (unsigned int i = 0; i < vertexCount; i++) { vertices[i].texCoords = glm::vec2(0.0f); }
+    }
+
+    if (hasTangents) {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            const aiVector3D &tangent = paiMesh->mTangents[i];
+            const aiVector3D &bitangent = paiMesh->mBitangents[i];
+            vertices[i].tangent = glm::vec3(tangent.x, tangent.y, tangent.z);
+            vertices[i].bitangent = glm::vec3(bitangent.x, bitangent.y, bitangent.z);
+        }
+    } else {
+        for (unsigned int i = 0; i < vertexCount; i++) { vertices[i].tangent = vertices[i].bitangent = glm::vec3(0.0f); }
+    }
+
+    glm::vec3 maxPos(-std::numeric_limits<float>::infinity()); glm::vec3 minPos(std::numeric_limits<float>::infinity());
+
+    // branch free per component min max
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        vertices[i].orthogonalize();
+        maxPos = glm::max(maxPos, vertices[i].position);
+        minPos = glm::min(minPos, vertices[i].position);
+    }
+
+    for (unsigned int i = 0 ; i < faceCount ; i++) {
         const aiFace &face = paiMesh->mFaces[i];
         // verify triangulation preprocess
         assert(face.mNumIndices == 3);
         // indices info
-        newSubMesh->indices.push_back(face.mIndices[0]);
-        newSubMesh->indices.push_back(face.mIndices[1]);
-        newSubMesh->indices.push_back(face.mIndices[2]);
+        indices[i * 3] = face.mIndices[0];
+        indices[i * 3 + 1] = face.mIndices[1];
+        indices[i * 3 + 2] = face.mIndices[2];
         // add face info
-        newSubMesh->faces.push_back(
-            types::Face(
-                newSubMesh->vertices[face.mIndices[0]],
-                newSubMesh->vertices[face.mIndices[1]],
-                newSubMesh->vertices[face.mIndices[2]],
-                face.mIndices[0],
-                face.mIndices[1],
-                face.mIndices[2]
-            )
-        );
-        // total mesh values
-        polyCount++;
+        newSubMesh->faces.push_back(types::Face(vertices[face.mIndices[0]], vertices[face.mIndices[1]], vertices[face.mIndices[2]], face.mIndices[0], face.mIndices[1], face.mIndices[2]));
     }
 
     // setting meshEntry center and min max bounds
-    newSubMesh->maxPoint = glm::vec3(maxPos.x, maxPos.y, maxPos.z);
-    newSubMesh->minPoint = glm::vec3(minPos.x, minPos.y, minPos.z);
-    newSubMesh->midPoint = glm::vec3((maxPos.x + minPos.x) / 2, (maxPos.y + minPos.y) / 2, (maxPos.z + minPos.z) / 2);
-    // setting meshEntry vertex and index buffer data
-    newSubMesh->generateBuffers();
-    newSubMesh->setBuffersData();
+    newSubMesh->maxPoint = maxPos;
+    newSubMesh->minPoint = minPos;
+    newSubMesh->midPoint = (maxPos + minPos) / 2.0f;
     // return created subMesh
     return newSubMesh;
 }
 
-bool Mesh::initMaterials(const aiScene *pScene, const std::string &sFilename)
+bool scene::Mesh::loadCooked(const std::string &sFileName, const bool geometryOnly, std::vector<utils::CookedMesh::MaterialData> &materialsData)
+{
+    utils::CookedMesh cooked;
+
+    if (!cooked.open(sFileName, IMPORT_FLAGS)) { return false; }
+
+    this->filename = cooked.getSceneName();
+    this->fileExtension = this->filename.substr(filename.find_last_of(".") + 1);
+    materialsData = cooked.getMaterials();
+
+    if (!geometryOnly) { initMaterials(cooked.getMaterials(), sFileName); }
+
+    glm::vec3 maxPos(-std::numeric_limits<float>::infinity()); glm::vec3 minPos(std::numeric_limits<float>::infinity());
+
+    for (auto it = cooked.getSubMeshes().begin(); it != cooked.getSubMeshes().end(); ++it) {
+        SubMesh *newSubMesh = new SubMesh();
+        newSubMesh->materialIndex = (*it).materialIndex;
+        newSubMesh->maxPoint = (*it).maxPoint;
+        newSubMesh->minPoint = (*it).minPoint;
+        newSubMesh->midPoint = ((*it).maxPoint + (*it).minPoint) / 2.0f;
+
+        // the buffers are fed straight from the mapping
+        if (!geometryOnly) {
+            newSubMesh->generateBuffers();
+            newSubMesh->setBuffersData((*it).vertices, (*it).vertexCount, (*it).indices, (*it).indexCount);
+        }
+
+        // cpu copy for mesh reduction, faces point into it
+        newSubMesh->vertices.assign((*it).vertices, (*it).vertices + (*it).vertexCount);
+        newSubMesh->indices.assign((*it).indices, (*it).indices + (*it).indexCount);
+        newSubMesh->faces.reserve((*it).indexCount / 3);
+
+        for (unsigned int i = 0; i + 2 < (*it).indexCount; i += 3) {
+            const unsigned int *face = &(*it).indices[i];
+            newSubMesh->faces.push_back(types::Face(newSubMesh->vertices[face[0]], newSubMesh->vertices[face[1]], newSubMesh->vertices[face[2]], face[0], face[1], face[2]));
+        }
+
+        this->vertexCount += (*it).vertexCount;
+        this->polyCount += (*it).indexCount / 3;
+        this->meshEntries.push_back(newSubMesh);
+        maxPos = glm::max(maxPos, (*it).maxPoint);
+        minPos = glm::min(minPos, (*it).minPoint);
+    }
+
+    this->maxPoint = maxPos;
+    this->minPoint = minPos;
+    this->midPoint = (maxPos + minPos) / 2.0f;
+    return true;
+}
+
+void scene::Mesh::saveCooked(const std::string &sFileName, const std::vector<utils::CookedMesh::MaterialData> &materialsData) const
+{
+    std::vector<utils::CookedMesh::SubMeshData> subMeshesData(this->meshEntries.size());
+
+    for (unsigned int i = 0; i < this->meshEntries.size(); i++) {
+        const SubMesh *subMesh = this->meshEntries[i];
+        subMeshesData[i].materialIndex = subMesh->materialIndex;
+        subMeshesData[i].minPoint = subMesh->getMinPoint();
+        subMeshesData[i].maxPoint = subMesh->getMaxPoint();
+        subMeshesData[i].vertexCount = subMesh->vertices.size();
+        subMeshesData[i].indexCount = subMesh->indices.size();
+        subMeshesData[i].vertices = subMesh->vertices.data();
+        subMeshesData[i].indices = subMesh->indices.data();
+    }
+
+    if (utils::CookedMesh::save(sFileName, IMPORT_FLAGS, this->filename, materialsData, subMeshesData)) {
+        std::cout << "Mesh(" << this << ") " << "Asset " << sFileName << " cooked to " << utils::CookedMesh::cookedFilename(sFileName) << std::endl;
+    }
+}
+
+void scene::Mesh::readMaterials(const aiScene *pScene, std::vector<utils::CookedMesh::MaterialData> &out) const
+{
+    static const types::Texture::TextureType TEXTURE_TYPES[] = {
+        types::Texture::Diffuse, types::Texture::Specular, types::Texture::Ambient, types::Texture::Emissive, types::Texture::Height, types::Texture::Normals,
+        types::Texture::Shininess, types::Texture::Opacity, types::Texture::Displacement, types::Texture::Lightmap, types::Texture::Reflection
+    };
+    out.resize(pScene->mNumMaterials);
+
+    for (unsigned int i = 0 ; i < pScene->mNumMaterials ; i++) {
+        const aiMaterial *pMaterial = pScene->mMaterials[i];
+        // default material properties, the same a material gets loading them itself
+        types::Material values;
+        values.loadMaterialValues(pMaterial);
+        out[i].ambient = values.ambient;
+        out[i].diffuse = values.diffuse;
+        out[i].specular = values.specular;
+        out[i].emission = values.emission;
+        out[i].shadingModel = values.shadingModel;
+        out[i].shininess = values.shininess;
+
+        for (unsigned int t = 0; t < sizeof(TEXTURE_TYPES) / sizeof(TEXTURE_TYPES[0]); t++) {
+            readMaterialTextures(pMaterial, TEXTURE_TYPES[t], out[i]);
+        }
+    }
+}
+
+std::string scene::Mesh::assetDirectory(const std::string &sFilename)
 {
     // Extract the directory part from the file name
     std::string::size_type slashIndex = sFilename.find_last_of("/");
-    std::string dir, dirPlusSlash;
+    std::string dir;
     std::string slashDir = "/";
     // Try with \ slashes if / didn't work out
 
@@ -170,44 +747,57 @@ bool Mesh::initMaterials(const aiScene *pScene, const std::string &sFilename)
         dir = sFilename.substr(0, slashIndex);
     }
 
-    dirPlusSlash = dir + slashDir;
+    return dir + slashDir;
+}
+
+bool Mesh::initMaterials(const std::vector<utils::CookedMesh::MaterialData> &materialsData, const std::string &sFilename)
+{
+    std::string dirPlusSlash = assetDirectory(sFilename);
     bool foundTextures = false;
 
     // Initialize the materials
-    for (unsigned int i = 0 ; i < pScene->mNumMaterials ; i++) {
-        const aiMaterial *pMaterial = pScene->mMaterials[i];
-        types::Material *currentMat = new types::Material();
-        // load all mesh associated textures
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Diffuse, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Specular, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Ambient, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Emissive, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Height, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Normals, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Shininess, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Opacity, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Displacement, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Lightmap, dirPlusSlash, currentMat);
-        foundTextures |= loadMeshTexture(pMaterial, types::Texture::TextureType::Reflection, dirPlusSlash, currentMat);
-
-        if (currentMat->textureCount() == 0) {
-            currentMat->addTexture(texCollection->getDefaultTexture());
-        }
-
-        // default material properties
-        currentMat->loadMaterialValues(pMaterial);
-        // Guess the shader type based on textures supplied
-        currentMat->guessMaterialShader();
+    for (auto it = materialsData.begin(); it != materialsData.end(); ++it) {
         // Save current mat to mesh materials
-        materials.push_back(currentMat);
+        materials.push_back(initMaterial(*it, dirPlusSlash, foundTextures));
     }
 
     // create a default material if no materials found
-    if (pScene->mNumMaterials <= 0) { materials.push_back(new types::Material()); materials.back()->addTexture(texCollection->getDefaultTexture()); }
+    if (materialsData.empty()) { materials.push_back(new types::Material()); materials.back()->addTexture(texCollection->getDefaultTexture()); }
 
     return foundTextures;
 }
 
+types::Material *scene::Mesh::initMaterial(const utils::CookedMesh::MaterialData &materialData, const std::string &dirPlusSlash, bool &foundTextures, const std::vector<FIBITMAP *> *images)
+{
+    types::Material *currentMat = new types::Material();
+
+    // load all mesh associated textures
+    for (auto tex = materialData.textures.begin(); tex != materialData.textures.end(); ++tex) {
+        const size_t index = tex - materialData.textures.begin();
+        // reserve space and create new texture, the decoded image is only uploaded
+        FIBITMAP *image = images && index < images->size() ? (*images)[index] : nullptr;
+        types::Texture *newTex = texCollection->addTexture(dirPlusSlash + (*tex).filename, (*tex).type, image);
+        // assign texture to material
+        currentMat->addTexture(nullptr == newTex ? texCollection->getDefaultTexture() : newTex, (*tex).type);
+        foundTextures = true;
+    }
+
+    if (currentMat->textureCount() == 0) {
+        currentMat->addTexture(texCollection->getDefaultTexture());
+    }
+
+    // default material properties
+    currentMat->ambient = materialData.ambient;
+    currentMat->diffuse = materialData.diffuse;
+    currentMat->specular = materialData.specular;
+    currentMat->emission = materialData.emission;
+    currentMat->shadingModel = materialData.shadingModel;
+    currentMat->shininess = materialData.shininess;
+    // Guess the shader type based on textures supplied
+    currentMat->guessMaterialShader();
+    return currentMat;
+}
+
 struct Cmp {
     bool operator()(const std::pair<unsigned int, double> &a, const std::pair<unsigned int, double> &b)
     {
@@ -241,9 +831,12 @@ void Mesh::render()
         glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)20);		// Vertex Normals
         glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)32);		// Vertex Tangents
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)44);		// Vertex Bitangets
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEntries[i]->IB);
+        // geomorphing second position stream
+        const bool geomorph = this->bindMorphTargets(meshEntries[i]);
         // Draw mesh triangles  with loaded buffer object data
-        glDrawElements(GL_TRIANGLES, meshEntries[i]->indicesCount, GL_UNSIGNED_INT, 0);
+        this->drawElements(meshEntries[i]);
+
+        if (geomorph) { glDisableVertexAttribArray(5); }
     }
 
     glDisableVertexAttribArray(0);
@@ -283,9 +876,12 @@ void scene::Mesh::render(const bool positions, const bool uvs, const bool normal
         normals    ? glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)20) : 0;	// Vertex Normals
         tangents   ? glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)32) : 0;	// Vertex Tangents
         bitangents ? glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), (const GLvoid *)44) : 0;	// Vertex Bitangets
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEntries[i]->IB);
+        // geomorphing moves positions, it only applies with the positions stream
+        const bool geomorph = positions && this->bindMorphTargets(meshEntries[i]);
         // Draw mesh triangles  with loaded buffer object data
-        glDrawElements(GL_TRIANGLES, meshEntries[i]->indicesCount, GL_UNSIGNED_INT, 0);
+        this->drawElements(meshEntries[i]);
+
+        if (geomorph) { glDisableVertexAttribArray(5); }
     }
 
     positions  ? glDisableVertexAttribArray(0) : 0;
@@ -295,6 +891,70 @@ void scene::Mesh::render(const bool positions, const bool uvs, const bool normal
     bitangents ? glDisableVertexAttribArray(4) : 0;
 }
 
+void scene::Mesh::renderShadowCaster()
+{
+    if (!enableRender) { return; }
+
+    glEnableVertexAttribArray(0);
+
+    for (unsigned int i = 0 ; i < meshEntries.size() ; i++) {
+        // ignore empty submeshes
+        if (!meshEntries[i]->enableRender) { continue; }
+
+        glBindBuffer(GL_ARRAY_BUFFER, meshEntries[i]->VB);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(types::Vertex), 0);						// Vertex Position
+
+        if (meshEntries[i]->drawShadowLevel) {
+            // the morph targets belong to the view level, the shadow level is drawn as is
+            const types::ShaderProgram *shp = types::ShaderProgram::getActiveProgram();
+
+            if (shp) { shp->setUniform(core::ShadersData::Uniforms::GEOMORPH_FACTOR_NAME, 0.0f); }
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEntries[i]->shadowLevelBuffered ? meshEntries[i]->SB : meshEntries[i]->IB);
+            glDrawElements(GL_TRIANGLES, meshEntries[i]->shadowIndicesCount, GL_UNSIGNED_INT, (const GLvoid *)(sizeof(unsigned int) * meshEntries[i]->shadowIndicesOffset));
+            continue;
+        }
+
+        const bool geomorph = this->bindMorphTargets(meshEntries[i]);
+        this->drawElements(meshEntries[i]);
+
+        if (geomorph) { glDisableVertexAttribArray(5); }
+    }
+
+    glDisableVertexAttribArray(0);
+}
+
+bool scene::Mesh::bindMorphTargets(const SubMesh *subMesh) const
+{
+    const types::ShaderProgram *shp = types::ShaderProgram::getActiveProgram();
+    const bool geomorph = subMesh->hasMorphTargets() && subMesh->geomorphFactor != 0.0f;
+
+    // the uniform stays set on the program, submeshes without morphing reset it
+    if (shp) { shp->setUniform(core::ShadersData::Uniforms::GEOMORPH_FACTOR_NAME, geomorph ? subMesh->geomorphFactor : 0.0f); }
+
+    if (!geomorph) { return false; }
+
+    glEnableVertexAttribArray(5);
+    glBindBuffer(GL_ARRAY_BUFFER, subMesh->MB);
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);							// Vertex Morph Target
+    return true;
+}
+
+void scene::Mesh::drawElements(const SubMesh *subMesh) const
+{
+    if (subMesh->drawComputedLevel) {
+        // the count was written by the compute shader, it never goes through the cpu
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh->LB);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, subMesh->DB);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh->IB);
+    glDrawElements(GL_TRIANGLES, subMesh->indicesCount, GL_UNSIGNED_INT, (const GLvoid *)(sizeof(unsigned int) * subMesh->indicesOffset));
+}
+
 void Mesh::SubMesh::generateBuffers()
 {
     glGenBuffers(1, &VB);
@@ -305,39 +965,292 @@ Mesh::SubMesh::SubMesh()
 {
     this->VB            = core::EngineData::Commoms::INVALID_VALUE;
     this->IB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->MB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->CB = this->LB = this->DB = core::EngineData::Commoms::INVALID_VALUE;
+    this->SB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->levelFence    = nullptr;
     this->materialIndex = core::EngineData::Commoms::INVALID_MATERIAL;
+    this->indicesOffset = 0;
     this->indicesCount  = 0;
+    this->vertexBufferCount = this->indexBufferCount = this->morphBufferCount = this->shadowBufferCount = 0;
+    this->geomorphFactor = 0.0f;
+    this->drawComputedLevel = false;
+    this->drawShadowLevel = this->shadowLevelBuffered = false;
+    this->shadowIndicesOffset = this->shadowIndicesCount = 0;
 }
 
 scene::Mesh::SubMesh::SubMesh(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<types::Face> &faces)
 {
     this->VB            = core::EngineData::Commoms::INVALID_VALUE;
     this->IB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->MB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->CB = this->LB = this->DB = core::EngineData::Commoms::INVALID_VALUE;
+    this->SB            = core::EngineData::Commoms::INVALID_VALUE;
+    this->levelFence    = nullptr;
     this->materialIndex = core::EngineData::Commoms::INVALID_MATERIAL;
     this->vertices      = vertices;
     this->indices       = indices;
     this->faces         = faces;
+    this->indicesOffset = 0;
     this->indicesCount	= indices.size();
+    this->vertexBufferCount = this->indexBufferCount = this->morphBufferCount = this->shadowBufferCount = 0;
+    this->geomorphFactor = 0.0f;
+    this->drawComputedLevel = false;
+    this->drawShadowLevel = this->shadowLevelBuffered = false;
+    this->shadowIndicesOffset = this->shadowIndicesCount = 0;
     this->generateBuffers();
     this->setBuffersData(vertices, indices);
 }
 
 void scene::Mesh::SubMesh::setBuffersData(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+    this->setBuffersData(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+void scene::Mesh::SubMesh::setBuffersData()
+{
+    this->setBuffersData(this->vertices, this->indices);
+}
+
+void scene::Mesh::SubMesh::setBuffersData(const types::Vertex *vertices, const unsigned int vertexCount, const unsigned int *indices, const unsigned int indexCount)
 {
     if (this->VB == core::EngineData::Commoms::INVALID_VALUE || this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
 
-    if (vertices.empty() || indices.empty()) { this->indicesCount = 0; return; }
+    if (vertexCount == 0 || indexCount == 0) { this->indicesCount = 0; return; }
+
+    this->indicesOffset = 0;
+    this->indicesCount = indexCount;
+    this->vertexBufferCount = vertexCount;
+    this->indexBufferCount = indexCount;
+    glBindBuffer(GL_ARRAY_BUFFER, VB);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(types::Vertex) * vertexCount, vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indexCount, indices, GL_STATIC_DRAW);
+}
+
+void scene::Mesh::SubMesh::setIndexBufferSubData(const std::vector<unsigned int> &indices, const unsigned int offset)
+{
+    if (this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
+
+    this->indicesOffset = 0;
+    this->indicesCount = indices.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
+
+    if (indices.size() > this->indexBufferCount) {
+        // storage is reallocated, the whole input has to be uploaded
+        this->indexBufferCount = indices.size();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    } else if (offset < indices.size()) {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * offset, sizeof(unsigned int) * (indices.size() - offset), &indices[offset]);
+    }
+}
+
+void scene::Mesh::SubMesh::setIndexBufferRanges(const std::vector<unsigned int> &indices, const std::vector<IndexRange> &ranges)
+{
+    if (this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
 
+    this->indicesOffset = 0;
     this->indicesCount = indices.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
+
+    if (indices.size() > this->indexBufferCount) {
+        this->indexBufferCount = indices.size();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+        return;
+    }
+
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if ((*it).count == 0 || (*it).offset + (*it).count > indices.size()) { continue; }
+
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * (*it).offset, sizeof(unsigned int) * (*it).count, &indices[(*it).offset]);
+    }
+}
+
+void scene::Mesh::SubMesh::reserveBuffers(const unsigned int vertexCount, const unsigned int indexCount)
+{
+    if (this->VB == core::EngineData::Commoms::INVALID_VALUE || this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
+
+    this->indicesOffset = 0;
+    this->indicesCount = 0;
+    this->vertexBufferCount = vertexCount;
+    this->indexBufferCount = indexCount;
     glBindBuffer(GL_ARRAY_BUFFER, VB);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(types::Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(types::Vertex) * vertexCount, nullptr, GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indexCount, nullptr, GL_STATIC_DRAW);
 }
 
-void scene::Mesh::SubMesh::setBuffersData()
+void scene::Mesh::SubMesh::setVertexBufferSubData(const std::vector<types::Vertex> &vertices, const unsigned int offset)
 {
-    this->setBuffersData(this->vertices, this->indices);
+    if (this->VB == core::EngineData::Commoms::INVALID_VALUE) { return; }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VB);
+
+    if (vertices.size() > this->vertexBufferCount) {
+        this->vertexBufferCount = vertices.size();
+        glBufferData(GL_ARRAY_BUFFER, sizeof(types::Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+    } else if (offset < vertices.size()) {
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(types::Vertex) * offset, sizeof(types::Vertex) * (vertices.size() - offset), &vertices[offset]);
+    }
+}
+
+void scene::Mesh::SubMesh::setMorphTargetsData(const std::vector<glm::vec3> &targets)
+{
+    if (targets.empty()) { return; }
+
+    if (this->MB == core::EngineData::Commoms::INVALID_VALUE) { glGenBuffers(1, &MB); }
+
+    glBindBuffer(GL_ARRAY_BUFFER, MB);
+
+    if (targets.size() > this->morphBufferCount) {
+        this->morphBufferCount = targets.size();
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * targets.size(), &targets[0], GL_STATIC_DRAW);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * targets.size(), &targets[0]);
+    }
+}
+
+void scene::Mesh::SubMesh::setShadowIndicesData(const std::vector<unsigned int> &indices, const unsigned int offset)
+{
+    if (this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
+
+    if (this->SB == core::EngineData::Commoms::INVALID_VALUE) { glGenBuffers(1, &SB); }
+
+    this->drawShadowLevel = this->shadowLevelBuffered = true;
+    this->shadowIndicesOffset = 0;
+    this->shadowIndicesCount = indices.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, SB);
+
+    if (indices.size() > this->shadowBufferCount) {
+        // storage is reallocated, the whole input has to be uploaded
+        this->shadowBufferCount = indices.size();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    } else if (offset < indices.size()) {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * offset, sizeof(unsigned int) * (indices.size() - offset), &indices[offset]);
+    }
+}
+
+bool scene::Mesh::SubMesh::hasMorphTargets() const
+{
+    return this->MB != core::EngineData::Commoms::INVALID_VALUE;
+}
+
+void scene::Mesh::SubMesh::setCollapseCandidatesData(const std::vector<unsigned int> &candidates)
+{
+    if (candidates.empty() || this->faces.empty()) { return; }
+
+    if (this->CB == core::EngineData::Commoms::INVALID_VALUE) {
+        glGenBuffers(1, &CB); glGenBuffers(1, &LB); glGenBuffers(1, &DB);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, CB);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * candidates.size(), &candidates[0], GL_STATIC_DRAW);
+    // a level never has more faces than the full resolution
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, LB);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * this->faces.size() * 3, nullptr, GL_DYNAMIC_COPY);
+    // count, instanceCount, firstIndex, baseVertex, baseInstance
+    const GLuint command[5] = { 0, 1, 0, 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, DB);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), command, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool scene::Mesh::SubMesh::hasCollapseCandidates() const
+{
+    return this->CB != core::EngineData::Commoms::INVALID_VALUE;
+}
+
+void scene::Mesh::SubMesh::computeLevelIndices(const types::ShaderProgram *program, const unsigned int vertexCount)
+{
+    if (!program || !this->hasCollapseCandidates() || this->IB == core::EngineData::Commoms::INVALID_VALUE) { return; }
+
+    // resets the appended count
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, DB);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    program->use();
+    program->setUniform(core::ShadersData::Uniforms::LEVEL_VERTEX_COUNT_NAME, vertexCount);
+    program->setUniform(core::ShadersData::Uniforms::LEVEL_FACE_COUNT_NAME, (unsigned int)this->faces.size());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, IB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, CB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, LB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, DB);
+
+    // one invocation per face, local size in collapse_indices.comp, the work groups
+    // of a dispatch are only guaranteed up to 65535 so big meshes take several
+    for (unsigned int baseFace = 0; baseFace < this->faces.size(); baseFace += MAX_DISPATCH_FACES) {
+        const unsigned int batchFaces = std::min((unsigned int)this->faces.size() - baseFace, MAX_DISPATCH_FACES);
+        program->setUniform(core::ShadersData::Uniforms::LEVEL_BASE_FACE_NAME, baseFace);
+        glDispatchCompute((batchFaces + 63) / 64, 1, 1);
+    }
+
+    // the draw reads the indices and the command written by the shader
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    for (GLuint i = 0; i < 4; i++) { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0); }
+
+    program->disable();
+    this->drawComputedLevel = true;
+
+    // the count is read once this signals, a previous level not read yet is stale
+    if (this->levelFence) { glDeleteSync(this->levelFence); }
+
+    this->levelFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool scene::Mesh::SubMesh::computedIndicesCount(unsigned int &count)
+{
+    if (!this->levelFence) { return false; }
+
+    // no timeout, only flushes so the fence gets signaled eventually
+    GLenum status = glClientWaitSync(this->levelFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+    if (status == GL_TIMEOUT_EXPIRED) { return false; }
+
+    glDeleteSync(this->levelFence);
+    this->levelFence = nullptr;
+
+    if (status == GL_WAIT_FAILED) { return false; }
+
+    // finished, reading the command back doesn't wait anymore
+    GLuint written = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, DB);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &written);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    count = written;
+    return true;
+}
+
+void scene::Mesh::SubMesh::computedIndices(std::vector<unsigned int> &out) const
+{
+    out.clear();
+
+    if (!this->hasCollapseCandidates()) { return; }
+
+    GLuint count = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, DB);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    out.resize(count);
+
+    if (count > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, LB);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int) * count, &out[0]);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+size_t scene::Mesh::SubMesh::cpuMemory() const
+{
+    return this->vertices.capacity() * sizeof(types::Vertex) + this->positions.capacity() * sizeof(glm::vec3) +
+           this->indices.capacity() * sizeof(unsigned int) + this->faces.capacity() * sizeof(types::Face);
+}
+
+size_t scene::Mesh::SubMesh::gpuMemory() const
+{
+    return this->vertexBufferCount * sizeof(types::Vertex) + this->indexBufferCount * sizeof(unsigned int) +
+           this->morphBufferCount * sizeof(glm::vec3) + this->shadowBufferCount * sizeof(unsigned int);
 }
 
 Mesh::SubMesh::~SubMesh()
@@ -354,42 +1267,67 @@ Mesh::SubMesh::~SubMesh()
     if (IB != core::EngineData::Commoms::INVALID_VALUE) {
         glDeleteBuffers(1, &IB);
     }
+
+    if (MB != core::EngineData::Commoms::INVALID_VALUE) {
+        glDeleteBuffers(1, &MB);
+    }
+
+    if (CB != core::EngineData::Commoms::INVALID_VALUE) {
+        glDeleteBuffers(1, &CB);
+        glDeleteBuffers(1, &LB);
+        glDeleteBuffers(1, &DB);
+    }
+
+    if (levelFence) {
+        glDeleteSync(levelFence);
+    }
+
+    if (SB != core::EngineData::Commoms::INVALID_VALUE) {
+        glDeleteBuffers(1, &SB);
+    }
 }
 
 void scene::Mesh::enableMeshReduction()
 {
-    if (this->meshReductionEnabled) { return; }
+    this->enableMeshReduction(utils::MelaxCurvature);
+}
+
+void scene::Mesh::enableMeshReduction(const utils::CollapseCost costFunction, const unsigned int discreteLevels /* = 0 */,
+                                      const unsigned int clusterGridResolution /* = 0 */)
+{
+    // the progressive meshes need the whole geometry
+    if (this->meshReductionEnabled || this->stream || this->asyncLoad || !this->pendingAssetKey.empty() || !restoreGeometry()) { return; }
+
+    // reduction rewrites the submeshes, a shared asset is copied first and an unshared
+    // one stops being shared
+    if (this->asset) { detachMeshEntries(); }
+    else { collections::MeshesCollection::Instance()->forgetAsset(this); }
 
     this->meshReductor = new utils::MeshReductor();
-    meshReductor->load(this);
+
+    // huge meshes get a coarse proxy first, edge collapse runs over it
+    if (clusterGridResolution > 0) { meshReductor->cluster(this, clusterGridResolution); }
+
+    meshReductor->load(this, costFunction);
+
+    if (discreteLevels > 0) { meshReductor->bakeLevels(discreteLevels); }
+
     this->meshReductionEnabled = true;
 }
 
-bool scene::Mesh::loadMeshTexture(const aiMaterial *pMaterial, types::Texture::TextureType textureType, std::string dirPlusSlash, types::Material *currentMat)
+void scene::Mesh::readMaterialTextures(const aiMaterial *pMaterial, types::Texture::TextureType textureType, utils::CookedMesh::MaterialData &out) const
 {
     int diffuseTextureCount = pMaterial->GetTextureCount((aiTextureType)textureType);
-    bool foundTextures = false;
 
     for (int tIndex = 0; tIndex < diffuseTextureCount; tIndex++) {
         aiString textureFilename;
 
         if (pMaterial->GetTexture((aiTextureType)textureType, tIndex, &textureFilename) == AI_SUCCESS) {
-            std::string fullPath = dirPlusSlash + textureFilename.data;
+            utils::CookedMesh::TextureReference tex;
+            tex.filename = textureFilename.data;
             // verify file extension, assimp loads wavefront .obj bump maps as height maps
-            textureType = this->fileExtension == "obj" && textureType == types::Texture::Height ? types::Texture::Normals : textureType;
-            // reserve space and create new texture
-            types::Texture *newTex = texCollection->addTexture(fullPath, textureType);
-
-            // assign texture to material
-            if (nullptr == newTex) {
-                currentMat->addTexture(texCollection->getDefaultTexture(), textureType);
-            } else {
-                currentMat->addTexture(newTex, textureType);
-            }
+            tex.type = this->fileExtension == "obj" && textureType == types::Texture::Height ? types::Texture::Normals : textureType;
+            out.textures.push_back(tex);
         }
-
-        foundTextures = true;
     }
-
-    return foundTextures;
 }
@@ -5,16 +5,23 @@
 #include "../types/Face.h"
 #include "../types/Material.h"
 #include "../types/Vertex.h"
+#include "../utils/CookedMesh.h"
 #include "Assimp/Importer.hpp"
 #include "Assimp/postprocess.h"
 #include "Assimp/scene.h"
 #include "GLM/glm.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <vector>
 
 namespace utils {
     class ProgressiveMesh;
     class MeshReductor;
+    class ProgressiveMeshStream;
+    class AsyncMeshLoad;
+    enum CollapseCost : unsigned int;
 }
 
 namespace scene {
@@ -23,6 +30,8 @@ namespace scene {
         public:
             void render();
             void render(const bool positions, const bool uvs, const bool normals, const bool tangents, const bool bitangents, const bool enableShaders = true);
+            // positions only with the submeshes shadow levels where set, for depth passes
+            void renderShadowCaster();
 
             unsigned int getPolyCount() const { return polyCount; }
             unsigned int getVertexCount() const { return vertexCount; }
@@ -34,8 +43,19 @@ namespace scene {
                     std::vector<types::Vertex> vertices;
                     std::vector<unsigned int> indices;
                     std::vector<types::Face> faces;
-                    // Rendering params
+                    // vertex positions kept instead of vertices, see Mesh::KeepPositions
+                    std::vector<glm::vec3> positions;
+                    // Rendering params, drawn range of the index buffer
+                    unsigned int indicesOffset;
                     unsigned int indicesCount;
+                    // discrete levels packed in the index buffer, see ProgressiveMesh::bakeLevels
+                    struct IndexRange {
+                        unsigned int offset;
+                        unsigned int count;
+                    };
+                    std::vector<IndexRange> indexLevels;
+                    // vertex shader blend towards the morph targets, 0.0 draws the vertices as is
+                    float geomorphFactor;
                     //  ogl data setting / handling
                     void generateBuffers();
                     // VB and IB need to set with generateBuffers() changes
@@ -43,6 +63,53 @@ namespace scene {
                     void setBuffersData(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices);
                     // uses class stored vertices and indexes
                     void setBuffersData();
+                    // uploads from any memory, a mapped file for example, no cpu copy is kept
+                    void setBuffersData(const types::Vertex *vertices, const unsigned int vertexCount, const unsigned int *indices, const unsigned int indexCount);
+                    // rewrites the index buffer from offset to the end of the input keeping
+                    // the buffer storage, grows the storage if the input doesn't fit, the
+                    // input indices are drawn from the buffer start
+                    void setIndexBufferSubData(const std::vector<unsigned int> &indices, const unsigned int offset);
+                    // rewrites only the given ranges of the input into the index buffer, the
+                    // whole input if the storage has to grow, the input is drawn as above
+                    void setIndexBufferRanges(const std::vector<unsigned int> &indices, const std::vector<IndexRange> &ranges);
+                    // allocates the buffers storage for the given counts without uploading, for
+                    // geometry that arrives in parts, nothing is drawn until the data is set
+                    void reserveBuffers(const unsigned int vertexCount, const unsigned int indexCount);
+                    // rewrites the vertex buffer from offset to the end of the input, grows
+                    // the storage if the input doesn't fit
+                    void setVertexBufferSubData(const std::vector<types::Vertex> &vertices, const unsigned int offset);
+                    // per vertex morph target positions, second position stream at location 5,
+                    // the buffer is created on first use
+                    void setMorphTargetsData(const std::vector<glm::vec3> &targets);
+                    bool hasMorphTargets() const;
+                    // gpu level generation, uploads the collapse candidate of every vertex
+                    // and creates the level indices and indirect draw buffers, gl 4.3
+                    void setCollapseCandidatesData(const std::vector<unsigned int> &candidates);
+                    bool hasCollapseCandidates() const;
+                    // gathers the faces collapsed down to vertexCount from the index buffer
+                    // into the level indices with the program, see collapse_indices.comp, and
+                    // draws them from then on, the index buffer has to be at full resolution
+                    void computeLevelIndices(const types::ShaderProgram *program, const unsigned int vertexCount);
+                    // polls the last computeLevelIndices without waiting, true once the gpu
+                    // finished it, count is then the indices it wrote, false afterwards
+                    bool computedIndicesCount(unsigned int &count);
+                    // reads the indices of the last computed level back, waits for the gpu,
+                    // for validation only, see utils::MeshReductor::setValidateComputeLevels
+                    void computedIndices(std::vector<unsigned int> &out) const;
+                    // the draw reads the computed level instead of the index buffer range
+                    bool drawComputedLevel;
+                    // shadow caster level, the shadow pass draws it instead of the view level, a
+                    // range of the index buffer or of the shadow index buffer if buffered
+                    bool drawShadowLevel;
+                    bool shadowLevelBuffered;
+                    unsigned int shadowIndicesOffset;
+                    unsigned int shadowIndicesCount;
+                    // rewrites the shadow index buffer from offset to the end of the input and
+                    // draws it as the shadow level, the buffer is created on first use
+                    void setShadowIndicesData(const std::vector<unsigned int> &indices, const unsigned int offset);
+                    // bytes held by the cpu copies and by the gl buffers
+                    size_t cpuMemory() const;
+                    size_t gpuMemory() const;
                 private:
                     friend class scene::Mesh;
                     // only mesh outer class can destroy and create mesh entries and manipulate the material indexes
@@ -50,21 +117,103 @@ namespace scene {
                     // OpenGL buffer objects identifiers
                     GLuint VB;
                     GLuint IB;
+                    GLuint MB;
+                    // collapse candidates, computed level indices and its indirect draw command
+                    GLuint CB;
+                    GLuint LB;
+                    GLuint DB;
+                    // signaled once the last computeLevelIndices finished
+                    GLsync levelFence;
+                    // shadow caster level indices
+                    GLuint SB;
+                    // elements allocated on each buffer object
+                    unsigned int vertexBufferCount;
+                    unsigned int indexBufferCount;
+                    unsigned int morphBufferCount;
+                    unsigned int shadowBufferCount;
 
                     SubMesh();
                     ~SubMesh();
                     SubMesh(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<types::Face> &faces);
             };
 
+            // cpu copies kept by the submeshes once uploaded, reduction needs them all
+            enum Residency {
+                KeepAll,
+                // vertex positions and indices
+                KeepPositions,
+                KeepNone,
+            };
+            enum LoadStatus {
+                NotLoaded,
+                Loading,
+                Loaded,
+                LoadFailed,
+            };
+            // called on the gl thread once a load finishes, with whether it succeeded
+            typedef std::function<void(Mesh *mesh, const bool succeeded)> LoadCallback;
+
             Mesh(void);
             ~Mesh(void);
 
-            bool loadMesh(const std::string &sFileName);
+            // geometryOnly skips the materials and the gl buffers, the submeshes only keep
+            // their cpu data, it needs no gl context, for offline processing, the assimp
+            // import is cooked next to the asset and later loads map it instead
+            bool loadMesh(const std::string &sFileName, const bool geometryOnly = false);
+            // starts reading a progressive mesh stream, see utils::ProgressiveMeshStream, the
+            // mesh draws its base meshes as soon as they arrive and refines with every
+            // updateStream call after, geometry only with a default material
+            bool loadProgressiveStream(const std::string &sFileName);
+            // uploads what arrived of the stream since the last call, gl thread only, the
+            // camera calls it for every mesh at the start of the frame
+            void updateStream();
+            bool isStreaming() const { return stream != nullptr; }
+            // returns at once with an empty mesh, the asset is imported on a background thread
+            // and updateLoad creates its materials and buffers, the submeshes show up one by
+            // one as they are uploaded, streams go to loadProgressiveStream
+            bool loadMeshAsync(const std::string &sFileName);
+            // uploads the background import a material or a submesh at a time until the
+            // deadline passes, at least one step per call, gl thread only, see
+            // collections::MeshesCollection::updateLoads
+            void updateLoad(const std::chrono::high_resolution_clock::time_point &deadline);
+            // cpu only part of loadMesh, the cooked import or the assimp geometry, without
+            // materials nor gl buffers, returns the materials data, safe off the gl thread,
+            // fails once cancelled is set, checked between the assimp read and the conversion
+            bool importAsset(const std::string &sFileName, std::vector<utils::CookedMesh::MaterialData> &materialsData, const std::atomic<bool> *cancelled = nullptr);
+            // asset directory with its trailing slash, textures are relative to it
+            static std::string assetDirectory(const std::string &sFilename);
+            LoadStatus getLoadStatus() const { return loadStatus; }
+            // called right away if the load already finished
+            void setLoadCallback(const LoadCallback &callback);
+            // draws the submeshes and materials of source, nothing is copied, the last mesh
+            // sharing them deletes them, a source still loading is shared once it finishes,
+            // see updateLoad, false if this mesh has geometry or source can't be shared
+            bool shareAsset(Mesh *source);
+            bool sharesAsset(const Mesh *mesh) const { return asset != nullptr && asset == mesh->asset; }
+            // meshes from the same file and import flags can share their asset
+            static std::string assetKey(const std::string &sFileName);
+            // drops the submeshes cpu copies the policy doesn't keep, restoreGeometry brings
+            // them back, meshes sharing an asset share its residency, false if the mesh
+            // is reduced, still loading or loaded from a progressive stream, even a finished
+            // one, these keep everything
+            bool setResidency(const Residency residency);
+            Residency getResidency() const { return asset && !uniqueMeshEntries ? asset->residency : residency; }
+            // refetches dropped cpu copies from the asset cooked import, or assimp without
+            // one, true once everything is resident
+            bool restoreGeometry();
+            // bytes held by the submeshes cpu copies and by their gl buffers, shared
+            // submeshes count in every mesh sharing them
+            size_t getCpuMemory() const;
+            size_t getGpuMemory() const;
             const unsigned int subMeshCount() const { return this->meshEntries.size(); }
+            // asset location this mesh was loaded from
+            const std::string &getFilepath() const { return filepath; }
+            // assimp post process flags used to import every asset
+            static const unsigned int IMPORT_FLAGS;
 
         protected:
 
-            Mesh(const Mesh &mesh) : polyCount(0), vertexCount(0), meshReductionEnabled(false) {};
+            Mesh(const Mesh &mesh) : polyCount(0), vertexCount(0), stream(nullptr), asyncLoad(nullptr), loadStatus(NotLoaded), asset(nullptr), uniqueMeshEntries(false), residency(KeepAll), meshReductionEnabled(false) {};
             unsigned int polyCount;
             unsigned int vertexCount;
 
@@ -77,11 +226,57 @@ namespace scene {
             std::vector<types::Material * > materials;
             // Engine Textures Collection
             collections::TexturesCollection *texCollection;
+            // stream still arriving, nullptr once complete
+            utils::ProgressiveMeshStream *stream;
+            // background import pending upload, nullptr once uploaded
+            utils::AsyncMeshLoad *asyncLoad;
+            LoadStatus loadStatus;
+            LoadCallback loadCallback;
+            // sets the load status and calls the load callback
+            void finishLoad(const bool succeeded);
+            // submeshes and materials of the meshes sharing an asset
+            struct SharedAsset {
+                unsigned int references;
+                std::vector<SubMesh *> meshEntries;
+                std::vector<types::Material *> materials;
+                // totals, the submeshes may not hold their cpu copies
+                unsigned int vertexCount;
+                unsigned int polyCount;
+                Residency residency;
+            };
+            SharedAsset *asset;
+            // the shared submeshes were copied for mesh reduction, the materials are still shared
+            bool uniqueMeshEntries;
+            // key of the loading asset this mesh shares once it finishes
+            std::string pendingAssetKey;
+            // of the unshared submeshes, see getResidency
+            Residency residency;
+            // copies the shared submeshes, mesh reduction rewrites them
+            void detachMeshEntries();
+            void releaseAsset();
 
-            Mesh::SubMesh *initMesh(unsigned int index, const aiMesh *paiMesh);
-            bool initFromScene(const aiScene *paiScene, const std::string &sFilename);
-            bool initMaterials(const aiScene *paiScene, const std::string &sFilename);
-            bool loadMeshTexture(const aiMaterial *pMaterial, types::Texture::TextureType textureType, std::string dirPlusSlash, types::Material *currentMat);
+            // converts the assimp mesh into a submesh with cpu data only, no gl buffers,
+            // it touches nothing else so submeshes convert in parallel, see initFromScene
+            Mesh::SubMesh *initMesh(unsigned int index, const aiMesh *paiMesh) const;
+            bool initFromScene(const aiScene *paiScene, const std::string &sFilename, const std::vector<utils::CookedMesh::MaterialData> &materialsData, const bool geometryOnly);
+            // creates the materials and loads their textures, true if any texture was found
+            bool initMaterials(const std::vector<utils::CookedMesh::MaterialData> &materialsData, const std::string &sFilename);
+            // images are the textures already decoded, in materialData order, see utils::AsyncMeshLoad
+            types::Material *initMaterial(const utils::CookedMesh::MaterialData &materialData, const std::string &dirPlusSlash, bool &foundTextures, const std::vector<FIBITMAP *> *images = nullptr);
+            // assimp import, the cooked import is written after it
+            bool importScene(const std::string &sFileName, std::vector<utils::CookedMesh::MaterialData> &materialsData, const bool geometryOnly,
+                             const std::atomic<bool> *cancelled = nullptr);
+            // assimp materials values and texture references
+            void readMaterials(const aiScene *paiScene, std::vector<utils::CookedMesh::MaterialData> &out) const;
+            void readMaterialTextures(const aiMaterial *pMaterial, types::Texture::TextureType textureType, utils::CookedMesh::MaterialData &out) const;
+            // builds the mesh from the asset cooked import, see utils::CookedMesh, false if there is none up to date
+            bool loadCooked(const std::string &sFileName, const bool geometryOnly, std::vector<utils::CookedMesh::MaterialData> &materialsData);
+            void saveCooked(const std::string &sFileName, const std::vector<utils::CookedMesh::MaterialData> &materialsData) const;
+            // sets the active program geomorph uniform and binds the submesh morph
+            // targets if it is morphing, returns if the location 5 stream was enabled
+            bool bindMorphTargets(const SubMesh *subMesh) const;
+            // draws the submesh index buffer range or its computed level
+            void drawElements(const SubMesh *subMesh) const;
 
             // Mesh Reduction properties
         protected:
@@ -92,6 +287,11 @@ namespace scene {
         public:
 
             void enableMeshReduction();
+            // generates the progressive meshes with the given collapse cost function,
+            // discreteLevels > 0 also bakes that many levels halving the vertex count, and
+            // clusterGridResolution > 0 generates them over a vertex clustering proxy,
+            // not available until a stream is complete
+            void enableMeshReduction(const utils::CollapseCost costFunction, const unsigned int discreteLevels = 0, const unsigned int clusterGridResolution = 0);
             utils::MeshReductor *getMeshReductor() const { return meshReductor; }
             bool isMeshReductionEnabled() const { return meshReductionEnabled; }
 
@@ -0,0 +1,62 @@
+// standalone mesh teardown test, destroys meshes while their background work is still
+// pending, geometry only loads so no gl context is created, link it with the renderer
+// sources and run it under a debug heap or address sanitizer to catch freed reads
+// usage: MeshTeardownTest [resources root]
+#include "..\scene\Mesh.h"
+#include "..\utils\ProgressiveMeshes.h"
+#include "..\collections\MeshesCollection.h"
+#include "..\core\Data.h"
+#include <iostream>
+
+// destroyed meshes per stored mesh, more rounds make the worker more likely to be mid level
+static const unsigned int TEARDOWN_ROUNDS = 32;
+// level requests queued before the mesh is deleted
+static const float REQUEST_RATIOS[] = { 0.5f, 0.25f, 0.125f };
+
+// the mesh goes right after its level requests, the reduction worker is still computing
+// the last one or about to, from the submeshes the destructor frees
+static bool destroyWithQueuedLevel(const std::string &filename, const utils::CollapseCost costFunction)
+{
+    scene::Mesh *mesh = new scene::Mesh();
+
+    if (!mesh->loadMesh(filename, true)) { delete mesh; return false; }
+
+    mesh->enableMeshReduction(costFunction);
+    utils::MeshReductor *meshReductor = mesh->getMeshReductor();
+
+    if (!meshReductor) { delete mesh; return false; }
+
+    for (unsigned int i = 0; i < sizeof(REQUEST_RATIOS) / sizeof(REQUEST_RATIOS[0]); i++) {
+        meshReductor->requestReduce(REQUEST_RATIOS[i]);
+    }
+
+    delete mesh;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::string resourcesRoot = argc > 1 ? argv[1] : ".";
+    unsigned int failed = 0;
+    // meshes touch these singletons
+    collections::TexturesCollection::Instance();
+    collections::MeshesCollection::Instance();
+
+    // without core::Data::Initialize, which needs gl, the execution dir stays empty
+    for (unsigned int i = 0; i < core::StoredMeshes::Count; i++) {
+        std::string filename = resourcesRoot + core::StoredMeshes::Filename(i);
+
+        for (unsigned int round = 0; round < TEARDOWN_ROUNDS; round++) {
+            utils::CollapseCost costFunction = round % 2 == 0 ? utils::MelaxCurvature : utils::QuadricErrorMetric;
+
+            if (destroyWithQueuedLevel(filename, costFunction)) { continue; }
+
+            std::cout << "MeshTeardownTest " << "Couldn't load " << filename << std::endl;
+            failed++;
+            break;
+        }
+    }
+
+    std::cout << "MeshTeardownTest " << (failed > 0 ? "failed" : "passed") << std::endl;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+// offline level of detail baker, loads every asset under a directory without a gl context,
+// generates its progressive meshes and bakes the discrete levels, the collapse data and the
+// levels are written next to each asset so render nodes only load them, link it with the
+// renderer sources, nodes have to enable mesh reduction with the same cost and levels
+// usage: ProgressiveMeshBaker <assets dir> [levels] [MelaxCurvature|QuadricErrorMetric]
+#include "..\scene\Mesh.h"
+#include "..\utils\ProgressiveMeshes.h"
+#include "..\collections\MeshesCollection.h"
+#include "..\core\Data.h"
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+// levels baked when none is given, from full resolution down to 1/16th
+static const unsigned int DEFAULT_LEVEL_COUNT = 5;
+
+// every file assimp can import, subdirectories included
+static void findAssets(const std::string &directory, const Assimp::Importer &importer, std::vector<std::string> &out)
+{
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+
+    if (find == INVALID_HANDLE_VALUE) { return; }
+
+    do {
+        std::string name = findData.cFileName;
+
+        if (name == "." || name == "..") { continue; }
+
+        std::string path = directory + "\\" + name;
+
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            findAssets(path, importer, out);
+        } else if (name.find_last_of(".") != std::string::npos && importer.IsExtensionSupported(name.substr(name.find_last_of(".")))) {
+            out.push_back(path);
+        }
+    } while (FindNextFileA(find, &findData));
+
+    FindClose(find);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cout << "usage: ProgressiveMeshBaker <assets dir> [levels] [MelaxCurvature|QuadricErrorMetric]" << std::endl;
+        return 1;
+    }
+
+    std::string assetsDirectory = argv[1];
+    unsigned int levelCount = argc > 2 ? (unsigned int)std::max(1, std::atoi(argv[2])) : DEFAULT_LEVEL_COUNT;
+    utils::CollapseCost costFunction = argc > 3 && std::string(argv[3]) == "QuadricErrorMetric" ? utils::QuadricErrorMetric : utils::MelaxCurvature;
+    std::vector<std::string> assets;
+    findAssets(assetsDirectory, Assimp::Importer(), assets);
+
+    if (assets.empty()) {
+        std::cout << "ProgressiveMeshBaker " << "no assets found in " << assetsDirectory << std::endl;
+        return 1;
+    }
+
+    // meshes touch these singletons, created here before any worker does
+    collections::TexturesCollection::Instance();
+    collections::MeshesCollection::Instance();
+    // each worker takes the next pending asset, the meshes aren't part of the
+    // collection so they share nothing but the log
+    std::atomic<unsigned int> nextAsset(0);
+    std::atomic<unsigned int> failedAssets(0);
+    std::mutex logMutex;
+    auto bakeWorker = [&](const bool spawned) {
+        for (unsigned int i = nextAsset++; i < assets.size(); i = nextAsset++) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            scene::Mesh *mesh = new scene::Mesh();
+            bool loaded = mesh->loadMesh(assets[i], true);
+
+            if (loaded) { mesh->enableMeshReduction(costFunction, levelCount); }
+
+            unsigned int polyCount = loaded ? mesh->getMeshReductor()->getOriginalPolyCount() : 0;
+            delete mesh;
+            long long elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+            std::lock_guard<std::mutex> lock(logMutex);
+
+            if (loaded) {
+                std::cout << "ProgressiveMeshBaker " << "baked " << assets[i] << " polycount (" << polyCount << ") in " << elapsedTime << "ms" << std::endl;
+            } else {
+                std::cout << "ProgressiveMeshBaker " << "Couldn't load " << assets[i] << std::endl;
+                failedAssets++;
+            }
+        }
+
+        // the last assets generation can spread over the cores the finished workers leave
+        if (spawned) { core::ExecutionInfo::ReleaseWorkers(1); }
+    };
+    // the baker workers come from the same cores as the generation threads of each asset
+    // so both together never go over the core count, the calling thread works too
+    const unsigned int spawnedWorkers = core::ExecutionInfo::TakeWorkers((unsigned int)assets.size() - 1);
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 0; i < spawnedWorkers; i++) {
+        workers.push_back(std::thread(bakeWorker, true));
+    }
+
+    bakeWorker(false);
+
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+        (*it).join();
+    }
+
+    std::cout << "ProgressiveMeshBaker " << assets.size() - failedAssets << " of " << assets.size() << " assets baked" << std::endl;
+    return failedAssets > 0 ? 1 : 0;
+}
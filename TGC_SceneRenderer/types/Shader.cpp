@@ -138,6 +138,10 @@ std::string types::Shader::getShaderTypeString()
             return "Geometry shader";
             break;
 
+        case types::Shader::Compute:
+            return "Compute shader";
+            break;
+
         default:
             break;
     }
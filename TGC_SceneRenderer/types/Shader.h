@@ -15,6 +15,7 @@ namespace types {
                 Vertex = GL_VERTEX_SHADER,
                 Fragment = GL_FRAGMENT_SHADER,
                 Geometry = GL_GEOMETRY_SHADER,
+                Compute = GL_COMPUTE_SHADER,
             };
 
             Shader(const ShaderType &shaderType);
@@ -7,6 +7,7 @@ types::ShaderProgram::ShaderProgram(void)
     this->programID           = glCreateProgram();
     this->fragmentShaderCount = 0;
     this->vertexShaderCount   = 0;
+    this->computeShaderCount  = 0;
 
     if (this->programID <= 0) {
         std::cout << "ShaderProgram(" << this << "): " << "Error Creating Shader Program" << std::endl;
@@ -22,6 +23,8 @@ types::ShaderProgram::~ShaderProgram(void)
     }
 
     glDeleteProgram(this->programID);
+
+    if (activeProgram == this) { activeProgram = nullptr; }
 }
 
 void types::ShaderProgram::attachShader(Shader *pShader)
@@ -32,12 +35,14 @@ void types::ShaderProgram::attachShader(Shader *pShader)
     if (pShader->getType() == Shader::Fragment) { this->fragmentShaderCount++; }
 
     if (pShader->getType() == Shader::Vertex) { this->vertexShaderCount++; }
+
+    if (pShader->getType() == Shader::Compute) { this->computeShaderCount++; }
 }
 
 bool types::ShaderProgram::link() const
 {
-    // Needs at least one fragment shader and one vertex shader to link the program
-    if (this->fragmentShaderCount >= 1 && this->vertexShaderCount >= 1) {
+    // Needs at least one fragment shader and one vertex shader to link the program, or a compute shader alone
+    if ((this->fragmentShaderCount >= 1 && this->vertexShaderCount >= 1) || (this->computeShaderCount >= 1 && this->fragmentShaderCount + this->vertexShaderCount == 0)) {
         // Link Attached Shaders to Program
         glLinkProgram(this->programID);
         // Check Linking Status
@@ -62,11 +67,13 @@ bool types::ShaderProgram::link() const
 void types::ShaderProgram::use() const
 {
     glUseProgram(this->programID);
+    activeProgram = this;
 }
 
 void types::ShaderProgram::disable() const
 {
     glUseProgram(0);
+    activeProgram = nullptr;
 }
 
 GLuint types::ShaderProgram::getUniform(const std::string &sUniformName) const
@@ -282,4 +289,6 @@ types::ShaderProgram::UniformBlockInfo::~UniformBlockInfo()
     delete[] this->offset;
 }
 
-std::unordered_map<std::string, types::ShaderProgram::UniformBlockInfo *> types::ShaderProgram::uniformBlocks;
\ No newline at end of file
+std::unordered_map<std::string, types::ShaderProgram::UniformBlockInfo *> types::ShaderProgram::uniformBlocks;
+
+const types::ShaderProgram *types::ShaderProgram::activeProgram = nullptr;
\ No newline at end of file
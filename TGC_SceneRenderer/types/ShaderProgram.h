@@ -35,8 +35,11 @@ namespace types {
             // associated shaders count
             unsigned int fragmentShaderCount;
             unsigned int vertexShaderCount;
+            unsigned int computeShaderCount;
             // shaders related to this shaderprogram
             std::vector<types::Shader *> attachedShaders;
+            // program set by the last use() call
+            static const ShaderProgram *activeProgram;
 
         public:
             ShaderProgram(void);
@@ -46,6 +49,8 @@ namespace types {
             bool link() const;
             void use() const;
             void disable() const;
+            // program in use, nullptr if none
+            static const ShaderProgram *getActiveProgram() { return activeProgram; }
             // adds a new uniform related to the shaderprogram
             unsigned int addUniform(const std::string &sUniformName);
             // returns the location integer of this uniform
@@ -62,6 +62,24 @@ bool types::Texture::loadTexture()
 }
 
 bool types::Texture::loadTexture(const std::string &sFilename)
+{
+    FIBITMAP *dib = decodeImage(sFilename);
+
+    //if the image failed to load, return failure
+    if (!dib) {
+        return false;
+    }
+
+    bool result = loadTexture(dib);
+    // Free FreeImage's copy of the data
+    FreeImage_Unload(dib);
+
+    if (result) { this->sFilename = sFilename; }
+
+    return result;
+}
+
+FIBITMAP *types::Texture::decodeImage(const std::string &sFilename)
 {
     //check the file signature and deduce its format
     FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(sFilename.c_str(), 0);
@@ -73,32 +91,35 @@ bool types::Texture::loadTexture(const std::string &sFilename)
 
     //if still unkown, return failure
     if (fif == FIF_UNKNOWN) {
-        return false;
+        return nullptr;
     }
 
     //pointer to the image, once loaded
-    FIBITMAP *dib = 0;
+    FIBITMAP *dib = nullptr;
 
     //check that the plugin has reading capabilities and load the file
     if (FreeImage_FIFSupportsReading(fif)) {
         dib = FreeImage_Load(fif, sFilename.c_str());
     }
 
-    //if the image failed to load, return failure
-    if (!dib) {
+    return dib;
+}
+
+bool types::Texture::loadTexture(FIBITMAP *image)
+{
+    if (!image) {
         return false;
     }
 
     // Retrieve the image raw data
-    BYTE *bits = FreeImage_GetBits(dib);
+    BYTE *bits = FreeImage_GetBits(image);
     //get the image width and height
-    width = FreeImage_GetWidth(dib);
-    height = FreeImage_GetHeight(dib);
-    bitsPerPixel = FreeImage_GetBPP(dib);
+    width = FreeImage_GetWidth(image);
+    height = FreeImage_GetHeight(image);
+    bitsPerPixel = FreeImage_GetBPP(image);
 
     // If this somehow one of these failed (they shouldn't), return failure
     if ((bitsPerPixel == 0) || (height == 0) || (width == 0)) {
-        FreeImage_Unload(dib);
         return false;
     }
 
@@ -123,9 +144,6 @@ bool types::Texture::loadTexture(const std::string &sFilename)
     }
 
     glBindTexture(GL_TEXTURE_2D, 0);
-    // Free FreeImage's copy of the data
-    FreeImage_Unload(dib);
-    this->sFilename = sFilename;
     // successful texture load
     return true;
 }
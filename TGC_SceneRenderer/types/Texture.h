@@ -59,6 +59,12 @@ namespace types {
             bool loadTexture();
             // loads texture from specified filepath
             bool loadTexture(const std::string &sFilename);
+            // creates the texture from an image already decoded, see decodeImage, the
+            // image stays owned by the caller
+            bool loadTexture(FIBITMAP *image);
+            // decodes an image file into pixels without touching gl, safe off the gl
+            // thread, nullptr on failure, release it with FreeImage_Unload
+            static FIBITMAP *decodeImage(const std::string &sFilename);
             // creates a texture based on passed parameters, saves the parameters to the texture object
             void createTexture(const unsigned int width, const unsigned int height,
                                const TextureFilteringMode min = Nearest,
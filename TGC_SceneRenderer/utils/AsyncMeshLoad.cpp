@@ -0,0 +1,48 @@
+#include "AsyncMeshLoad.h"
+using namespace utils;
+
+utils::AsyncMeshLoad::~AsyncMeshLoad()
+{
+    // assimp can't be interrupted, the worker checks the flag once its read returns
+    this->cancelled = true;
+
+    if (this->worker.joinable()) { this->worker.join(); }
+
+    delete this->staging;
+
+    for (auto it = this->images.begin(); it != this->images.end(); ++it) {
+        for (auto image = (*it).begin(); image != (*it).end(); ++image) {
+            if (*image) { FreeImage_Unload(*image); }
+        }
+    }
+}
+
+bool utils::AsyncMeshLoad::start(const std::string &sFilename)
+{
+    if (this->staging) { return false; }
+
+    // created here, the mesh constructor touches the textures collection
+    this->staging = new scene::Mesh();
+    this->worker = std::thread(&AsyncMeshLoad::import, this, sFilename);
+    return true;
+}
+
+void utils::AsyncMeshLoad::import(const std::string sFilename)
+{
+    this->succeeded = this->staging->importAsset(sFilename, this->materialsData, &this->cancelled);
+    const std::string dirPlusSlash = scene::Mesh::assetDirectory(sFilename);
+    this->images.resize(this->materialsData.size());
+
+    // decoding is most of a texture load, the gl thread is left with the upload only
+    for (unsigned int i = 0; this->succeeded && i < this->materialsData.size(); i++) {
+        const std::vector<CookedMesh::TextureReference> &textures = this->materialsData[i].textures;
+        this->images[i].assign(textures.size(), nullptr);
+
+        for (unsigned int j = 0; j < textures.size() && !this->cancelled; j++) {
+            this->images[i][j] = types::Texture::decodeImage(dirPlusSlash + textures[j].filename);
+        }
+    }
+
+    // publishes the staging mesh, the images and succeeded to the gl thread
+    this->imported = true;
+}
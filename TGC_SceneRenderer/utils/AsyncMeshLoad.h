@@ -0,0 +1,45 @@
+#pragma once
+#include "..\scene\Mesh.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+    // imports an asset on a background thread into a staging mesh nobody draws, its
+    // cooked import or assimp, see scene::Mesh::importAsset, and decodes its textures,
+    // the submeshes only hold cpu data, the owner mesh creates the materials, uploads
+    // the decoded textures and creates the buffers on the gl thread
+    class AsyncMeshLoad {
+        public:
+            AsyncMeshLoad() : uploadedMaterials(0), uploadedSubMeshes(0), staging(nullptr), imported(false), cancelled(false), succeeded(false) {};
+            // cancels the import and joins the worker, it stops after the assimp read or the
+            // texture it is decoding, only then the staging mesh and the images go
+            ~AsyncMeshLoad();
+
+            // starts the import on a background thread
+            bool start(const std::string &sFilename);
+            // the import finished, staging, materialsData and images can be read from then on
+            bool isImported() const { return imported; }
+            bool hasSucceeded() const { return succeeded; }
+            scene::Mesh *getStaging() const { return staging; }
+            const std::vector<CookedMesh::MaterialData> &getMaterialsData() const { return materialsData; }
+            // decoded image of every materialsData texture, in the same order, nullptr if
+            // it couldn't be decoded, owned by the load
+            const std::vector<std::vector<FIBITMAP *>> &getImages() const { return images; }
+            // upload progress, advanced by the owner mesh
+            unsigned int uploadedMaterials;
+            unsigned int uploadedSubMeshes;
+
+        private:
+            std::thread worker;
+            scene::Mesh *staging;
+            std::vector<CookedMesh::MaterialData> materialsData;
+            std::vector<std::vector<FIBITMAP *>> images;
+            std::atomic<bool> imported;
+            std::atomic<bool> cancelled;
+            bool succeeded;
+            void import(const std::string sFilename);
+    };
+}
@@ -0,0 +1,184 @@
+#include "CookedMesh.h"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+using namespace utils;
+
+const char *utils::CookedMesh::FILE_EXTENSION = ".cooked";
+
+// strings are padded so the vertex arrays stay 4 bytes aligned in the mapping
+static const unsigned int FILE_ALIGNMENT = 4;
+
+static void writeUint(std::ofstream &file, const unsigned int value)
+{
+    file.write((const char *)&value, sizeof(value));
+}
+
+static void writeString(std::ofstream &file, const std::string &value)
+{
+    static const char padding[FILE_ALIGNMENT] = { 0 };
+    writeUint(file, value.size());
+    file.write(value.data(), value.size());
+    file.write(padding, (FILE_ALIGNMENT - value.size() % FILE_ALIGNMENT) % FILE_ALIGNMENT);
+}
+
+// one lock per sidecar, a background import and a synchronous load of the same asset
+// may cook it while the other writes or maps it, the locks are never released
+static std::mutex &fileLock(const std::string &sCookedFilename)
+{
+    static std::mutex locksMutex;
+    static std::map<std::string, std::mutex> locks;
+    std::lock_guard<std::mutex> lock(locksMutex);
+    return locks[sCookedFilename];
+}
+
+utils::CookedMesh::~CookedMesh()
+{
+    this->close();
+}
+
+std::string utils::CookedMesh::cookedFilename(const std::string &sAssetFilename)
+{
+    return sAssetFilename + FILE_EXTENSION;
+}
+
+bool utils::CookedMesh::save(const std::string &sAssetFilename, const unsigned int importFlags, const std::string &sceneName,
+                             const std::vector<MaterialData> &materials, const std::vector<SubMeshData> &subMeshes)
+{
+    unsigned long long assetSize = 0, assetModified = 0;
+
+    if (!MappedFile::fileStamp(sAssetFilename, assetSize, assetModified)) { return false; }
+
+    std::string sCookedFilename = cookedFilename(sAssetFilename);
+    std::lock_guard<std::mutex> lock(fileLock(sCookedFilename));
+    std::ofstream file(sCookedFilename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+    if (!file.is_open()) {
+        std::cout << "CookedMesh " << "couldn't write cooked file " << sCookedFilename << std::endl;
+        return false;
+    }
+
+    writeUint(file, FILE_MAGIC);
+    writeUint(file, FILE_VERSION);
+    writeUint(file, importFlags);
+    writeUint(file, sizeof(types::Vertex));
+    file.write((const char *)&assetSize, sizeof(assetSize));
+    file.write((const char *)&assetModified, sizeof(assetModified));
+    writeString(file, sceneName);
+    writeUint(file, materials.size());
+    writeUint(file, subMeshes.size());
+
+    for (auto it = materials.begin(); it != materials.end(); ++it) {
+        file.write((const char *)&(*it).ambient, sizeof(glm::vec3));
+        file.write((const char *)&(*it).diffuse, sizeof(glm::vec3));
+        file.write((const char *)&(*it).specular, sizeof(glm::vec3));
+        file.write((const char *)&(*it).emission, sizeof(glm::vec3));
+        file.write((const char *)&(*it).shadingModel, sizeof(int));
+        file.write((const char *)&(*it).shininess, sizeof(float));
+        writeUint(file, (*it).textures.size());
+
+        for (auto tex = (*it).textures.begin(); tex != (*it).textures.end(); ++tex) {
+            writeUint(file, (unsigned int)(*tex).type);
+            writeString(file, (*tex).filename);
+        }
+    }
+
+    for (auto it = subMeshes.begin(); it != subMeshes.end(); ++it) {
+        writeUint(file, (*it).materialIndex);
+        file.write((const char *)&(*it).minPoint, sizeof(glm::vec3));
+        file.write((const char *)&(*it).maxPoint, sizeof(glm::vec3));
+        writeUint(file, (*it).vertexCount);
+        writeUint(file, (*it).indexCount);
+        file.write((const char *)(*it).vertices, sizeof(types::Vertex) * (*it).vertexCount);
+        file.write((const char *)(*it).indices, sizeof(unsigned int) * (*it).indexCount);
+    }
+
+    return (bool)file;
+}
+
+bool utils::CookedMesh::open(const std::string &sAssetFilename, const unsigned int importFlags)
+{
+    this->close();
+    unsigned long long assetSize = 0, assetModified = 0;
+
+    if (!MappedFile::fileStamp(sAssetFilename, assetSize, assetModified)) { return false; }
+
+    // a save in progress would be mapped half written
+    std::lock_guard<std::mutex> lock(fileLock(cookedFilename(sAssetFilename)));
+
+    if (!this->mapped.open(cookedFilename(sAssetFilename))) { return false; }
+
+    if (!this->parse(importFlags, assetSize, assetModified)) { this->close(); return false; }
+
+    return true;
+}
+
+bool utils::CookedMesh::parse(const unsigned int importFlags, const unsigned long long assetSize, const unsigned long long assetModified)
+{
+    MappedFile::Reader reader = this->mapped.reader();
+    unsigned int magic = 0, version = 0, storedFlags = 0, vertexSize = 0, materialCount = 0, subMeshCount = 0;
+    unsigned long long storedSize = 0, storedModified = 0;
+    reader.read(&magic, sizeof(magic));
+    reader.read(&version, sizeof(version));
+    reader.read(&storedFlags, sizeof(storedFlags));
+    reader.read(&vertexSize, sizeof(vertexSize));
+    reader.read(&storedSize, sizeof(storedSize));
+    reader.read(&storedModified, sizeof(storedModified));
+
+    // a different asset or import, or a vertex layout from another build
+    if (magic != FILE_MAGIC || version != FILE_VERSION || storedFlags != importFlags || vertexSize != sizeof(types::Vertex) ||
+            storedSize != assetSize || storedModified != assetModified) { return false; }
+
+    if (!reader.readString(this->sceneName, FILE_ALIGNMENT) || !reader.read(&materialCount, sizeof(materialCount)) || !reader.read(&subMeshCount, sizeof(subMeshCount))) { return false; }
+
+    this->materials.resize(materialCount);
+
+    for (auto it = this->materials.begin(); it != this->materials.end(); ++it) {
+        unsigned int textureCount = 0;
+        bool valid = reader.read(&(*it).ambient, sizeof(glm::vec3)) && reader.read(&(*it).diffuse, sizeof(glm::vec3)) &&
+                     reader.read(&(*it).specular, sizeof(glm::vec3)) && reader.read(&(*it).emission, sizeof(glm::vec3)) &&
+                     reader.read(&(*it).shadingModel, sizeof(int)) && reader.read(&(*it).shininess, sizeof(float)) && reader.read(&textureCount, sizeof(textureCount));
+
+        if (!valid) { return false; }
+
+        for (unsigned int i = 0; i < textureCount; i++) {
+            TextureReference tex; unsigned int type = 0;
+
+            if (!reader.read(&type, sizeof(type)) || !reader.readString(tex.filename, FILE_ALIGNMENT) || type >= (unsigned int)types::Texture::Count) { return false; }
+
+            tex.type = (types::Texture::TextureType)type;
+            (*it).textures.push_back(tex);
+        }
+    }
+
+    this->subMeshes.resize(subMeshCount);
+
+    for (auto it = this->subMeshes.begin(); it != this->subMeshes.end(); ++it) {
+        bool valid = reader.read(&(*it).materialIndex, sizeof(unsigned int)) && reader.read(&(*it).minPoint, sizeof(glm::vec3)) &&
+                     reader.read(&(*it).maxPoint, sizeof(glm::vec3)) && reader.read(&(*it).vertexCount, sizeof(unsigned int)) &&
+                     reader.read(&(*it).indexCount, sizeof(unsigned int));
+
+        if (!valid || (*it).indexCount % 3 != 0 || ((*it).materialIndex >= materialCount && materialCount > 0)) { return false; }
+
+        // the arrays are used in place
+        (*it).vertices = (const types::Vertex *)reader.skip(sizeof(types::Vertex) * (size_t)(*it).vertexCount);
+        (*it).indices = (const unsigned int *)reader.skip(sizeof(unsigned int) * (size_t)(*it).indexCount);
+
+        if (!(*it).vertices || !(*it).indices) { return false; }
+
+        for (unsigned int i = 0; i < (*it).indexCount; i++) {
+            if ((*it).indices[i] >= (*it).vertexCount) { return false; }
+        }
+    }
+
+    return reader.atEnd();
+}
+
+void utils::CookedMesh::close()
+{
+    this->mapped.close();
+    this->sceneName.clear();
+    this->materials.clear();
+    this->subMeshes.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "..\types\Texture.h"
+#include "..\types\Vertex.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace utils {
+
+    // binary sidecar next to an asset with what its assimp import produces, every submesh
+    // vertices, indices, bounds and material index plus the materials values and texture
+    // references, valid while the asset size, modification time and import flags match,
+    // opening it maps the file so the submeshes buffers are fed straight from the mapping
+    class CookedMesh {
+        public:
+            struct TextureReference {
+                // relative to the asset directory, as the asset references it
+                std::string filename;
+                types::Texture::TextureType type;
+            };
+            struct MaterialData {
+                glm::vec3 ambient;
+                glm::vec3 diffuse;
+                glm::vec3 specular;
+                glm::vec3 emission;
+                int shadingModel;
+                float shininess;
+                std::vector<TextureReference> textures;
+            };
+            // submesh data, when opened the pointers point into the mapping and stay valid until close
+            struct SubMeshData {
+                unsigned int materialIndex;
+                glm::vec3 minPoint;
+                glm::vec3 maxPoint;
+                unsigned int vertexCount;
+                unsigned int indexCount;
+                const types::Vertex *vertices;
+                const unsigned int *indices;
+            };
+
+            CookedMesh() {};
+            ~CookedMesh();
+
+            // sidecar file location for the given asset
+            static std::string cookedFilename(const std::string &sAssetFilename);
+            // writes the import of the asset, sceneName is the assimp root node name, one
+            // thread at a time per asset, the file can't be written while it is mapped
+            static bool save(const std::string &sAssetFilename, const unsigned int importFlags, const std::string &sceneName,
+                             const std::vector<MaterialData> &materials, const std::vector<SubMeshData> &subMeshes);
+
+            // maps the asset sidecar, false if it is missing, stale or malformed, never
+            // while another thread is saving it
+            bool open(const std::string &sAssetFilename, const unsigned int importFlags);
+            // unmaps the file, the submeshes data pointers are invalid after
+            void close();
+            const std::string &getSceneName() const { return sceneName; }
+            const std::vector<MaterialData> &getMaterials() const { return materials; }
+            const std::vector<SubMeshData> &getSubMeshes() const { return subMeshes; }
+
+        private:
+            static const unsigned int FILE_MAGIC = 0x4b434754; // "TGCK"
+            static const unsigned int FILE_VERSION = 1;
+            static const char *FILE_EXTENSION;
+
+            MappedFile mapped;
+            std::string sceneName;
+            std::vector<MaterialData> materials;
+            std::vector<SubMeshData> subMeshes;
+            // reads the mapped file, false if anything falls outside it
+            bool parse(const unsigned int importFlags, const unsigned long long assetSize, const unsigned long long assetModified);
+    };
+}
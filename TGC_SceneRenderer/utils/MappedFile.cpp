@@ -0,0 +1,86 @@
+#include "MappedFile.h"
+#include <cstring>
+using namespace utils;
+
+bool utils::MappedFile::Reader::read(void *out, const size_t bytes)
+{
+    if (bytes > size - offset) { return false; }
+
+    memcpy(out, data + offset, bytes);
+    offset += bytes;
+    return true;
+}
+
+const char *utils::MappedFile::Reader::skip(const size_t bytes)
+{
+    if (bytes > size - offset) { return nullptr; }
+
+    const char *start = data + offset;
+    offset += bytes;
+    return start;
+}
+
+bool utils::MappedFile::Reader::readString(std::string &out, const unsigned int alignment)
+{
+    unsigned int length = 0;
+
+    if (!read(&length, sizeof(length))) { return false; }
+
+    const char *start = skip((size_t)length + (alignment - length % alignment) % alignment);
+
+    if (!start) { return false; }
+
+    out.assign(start, length);
+    return true;
+}
+
+utils::MappedFile::~MappedFile()
+{
+    this->close();
+}
+
+bool utils::MappedFile::open(const std::string &sFilename)
+{
+    this->close();
+    this->file = CreateFileA(sFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (this->file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER fileSize;
+
+    // empty files can't be mapped
+    if (!GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0) { this->close(); return false; }
+
+    this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    this->view = this->mapping ? (const char *)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    this->viewSize = (size_t)fileSize.QuadPart;
+
+    if (!this->view) { this->close(); return false; }
+
+    return true;
+}
+
+void utils::MappedFile::close()
+{
+    if (this->view) { UnmapViewOfFile(this->view); }
+
+    if (this->mapping) { CloseHandle(this->mapping); }
+
+    if (this->file != INVALID_HANDLE_VALUE) { CloseHandle(this->file); }
+
+    this->file = INVALID_HANDLE_VALUE;
+    this->mapping = nullptr;
+    this->view = nullptr;
+    this->viewSize = 0;
+}
+
+bool utils::MappedFile::fileStamp(const std::string &sFilename, unsigned long long &size, unsigned long long &modified)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+    if (!GetFileAttributesExA(sFilename.c_str(), GetFileExInfoStandard, &attributes)) { return false; }
+
+    size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    modified = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
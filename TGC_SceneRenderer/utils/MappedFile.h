@@ -0,0 +1,46 @@
+#pragma once
+#include <windows.h>
+#include <string>
+
+namespace utils {
+
+    // read only memory mapping of a whole file, for the binary sidecars
+    class MappedFile {
+        public:
+            // bounds checked reads over the mapping
+            class Reader {
+                public:
+                    Reader(const char *data, const size_t size) : data(data), size(size), offset(0) {};
+                    bool read(void *out, const size_t bytes);
+                    // pointer to bytes inside the mapping, nullptr if they fall outside it
+                    const char *skip(const size_t bytes);
+                    // u32 length and the bytes padded to alignment
+                    bool readString(std::string &out, const unsigned int alignment);
+                    bool atEnd() const { return offset == size; }
+
+                private:
+                    const char *data;
+                    size_t size;
+                    size_t offset;
+            };
+
+            MappedFile() : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), viewSize(0) {};
+            ~MappedFile();
+
+            // false if the file is missing, empty or can't be mapped
+            bool open(const std::string &sFilename);
+            void close();
+            const char *data() const { return view; }
+            size_t size() const { return viewSize; }
+            Reader reader() const { return Reader(view, viewSize); }
+            // file size and last modification time, false if it can't be read
+            static bool fileStamp(const std::string &sFilename, unsigned long long &size, unsigned long long &modified);
+
+        private:
+            HANDLE file;
+            HANDLE mapping;
+            const char *view;
+            size_t viewSize;
+            MappedFile(const MappedFile &cpy);
+    };
+}
@@ -0,0 +1,299 @@
+#include "ProgressiveMeshCache.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <iostream>
+using namespace utils;
+
+const char *utils::ProgressiveMeshCache::FILE_EXTENSION = ".pmcache";
+const char *utils::ProgressiveMeshCache::LEVELS_FILE_EXTENSION = ".pmlevels";
+
+// fnv-1a 64 bits constants
+static const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const unsigned long long FNV_PRIME = 1099511628211ULL;
+
+static unsigned long long hashBytes(unsigned long long hash, const char *data, const size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// permutations is a permutation of [0, n) and every candidate is a vertex removed later,
+// so a lower slot, or 0 for vertices without candidate, anything else would index out of
+// the submesh in the permute and collapse code
+static bool validCollapseData(const ProgressiveMesh &progMesh)
+{
+    const unsigned int vertexCount = progMesh.permutations.size();
+    std::vector<bool> permuted(vertexCount, false);
+
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        const int slot = progMesh.permutations[i];
+        const int candidate = progMesh.candidatesMap[i];
+
+        if (slot < 0 || (unsigned int)slot >= vertexCount || permuted[slot]) { return false; }
+
+        permuted[slot] = true;
+
+        if (candidate < 0 || (candidate > 0 && (unsigned int)candidate >= i)) { return false; }
+    }
+
+    return true;
+}
+
+// vertex counts within the submesh and going down as the ratios do, ranges inside the
+// full resolution indices plus the levels ones, and those inside the submesh vertices
+static bool validLevels(const ProgressiveMesh::BakedLevels &levels, const std::vector<float> &ratios, const unsigned int vertexCount, const unsigned int fullIndexCount)
+{
+    for (unsigned int i = 0; i < levels.vertexCounts.size(); i++) {
+        if (levels.vertexCounts[i] > vertexCount) { return false; }
+
+        if (i > 0 && ratios[i] <= ratios[i - 1] && levels.vertexCounts[i] > levels.vertexCounts[i - 1]) { return false; }
+
+        if (i > 0 && ratios[i] >= ratios[i - 1] && levels.vertexCounts[i] < levels.vertexCounts[i - 1]) { return false; }
+
+        if ((unsigned long long)levels.ranges[i].offset + levels.ranges[i].count > (unsigned long long)fullIndexCount + levels.indices.size()) { return false; }
+    }
+
+    for (auto it = levels.indices.begin(); it != levels.indices.end(); ++it) {
+        if (*it >= vertexCount) { return false; }
+    }
+
+    return true;
+}
+
+unsigned long long utils::ProgressiveMeshCache::contentHash(const std::string &sFilename)
+{
+    MappedFile file;
+
+    if (!file.open(sFilename)) { return 0; }
+
+    return hashBytes(FNV_OFFSET_BASIS, file.data(), file.size());
+}
+
+unsigned long long utils::ProgressiveMeshCache::cacheKey(const unsigned int importFlags, const CollapseCost costFunction, const unsigned int clusterGridResolution /* = 0 */)
+{
+    // generation options are part of the key, different options different data
+    const unsigned int options[] = { importFlags, (unsigned int)costFunction, FILE_VERSION, clusterGridResolution };
+    return hashBytes(FNV_OFFSET_BASIS, (const char *)options, sizeof(options));
+}
+
+bool utils::ProgressiveMeshCache::writeAssetStamp(std::ofstream &file, const std::string &sAssetFilename)
+{
+    unsigned long long assetSize = 0, assetModified = 0, assetHash = contentHash(sAssetFilename);
+
+    if (!MappedFile::fileStamp(sAssetFilename, assetSize, assetModified) || assetHash == 0) { return false; }
+
+    file.write((const char *)&assetSize, sizeof(assetSize));
+    file.write((const char *)&assetModified, sizeof(assetModified));
+    file.write((const char *)&assetHash, sizeof(assetHash));
+    return true;
+}
+
+bool utils::ProgressiveMeshCache::readAssetStamp(MappedFile::Reader &reader, const std::string &sAssetFilename)
+{
+    unsigned long long storedSize = 0, storedModified = 0, storedHash = 0, assetSize = 0, assetModified = 0;
+
+    if (!reader.read(&storedSize, sizeof(storedSize)) || !reader.read(&storedModified, sizeof(storedModified)) || !reader.read(&storedHash, sizeof(storedHash))) { return false; }
+
+    if (!MappedFile::fileStamp(sAssetFilename, assetSize, assetModified) || assetSize != storedSize) { return false; }
+
+    // untouched since the sidecar was written, the asset isn't read at all, only a
+    // touched asset with the same size is hashed
+    return assetModified == storedModified || contentHash(sAssetFilename) == storedHash;
+}
+
+std::string utils::ProgressiveMeshCache::cacheFilename(const std::string &sAssetFilename)
+{
+    return sAssetFilename + FILE_EXTENSION;
+}
+
+std::string utils::ProgressiveMeshCache::levelsFilename(const std::string &sAssetFilename)
+{
+    return sAssetFilename + LEVELS_FILE_EXTENSION;
+}
+
+bool utils::ProgressiveMeshCache::load(const std::string &sAssetFilename, const unsigned long long key, const std::vector<scene::Mesh::SubMesh *> &subMeshes,
+                                       std::vector<ProgressiveMesh> &outProgMeshes)
+{
+    MappedFile file;
+
+    if (!file.open(cacheFilename(sAssetFilename))) { return false; }
+
+    MappedFile::Reader reader = file.reader();
+    unsigned int magic = 0, version = 0, subMeshCount = 0;
+    unsigned long long storedKey = 0;
+    reader.read(&magic, sizeof(magic));
+    reader.read(&version, sizeof(version));
+    reader.read(&storedKey, sizeof(storedKey));
+
+    if (magic != FILE_MAGIC || version != FILE_VERSION || storedKey != key || !readAssetStamp(reader, sAssetFilename)) { return false; }
+
+    if (!reader.read(&subMeshCount, sizeof(subMeshCount)) || subMeshCount != subMeshes.size() || outProgMeshes.size() != subMeshCount) { return false; }
+
+    for (unsigned int i = 0; i < subMeshCount; i++) {
+        unsigned int vertexCount = 0, polyCount = 0;
+        bool valid = reader.read(&vertexCount, sizeof(vertexCount)) && reader.read(&polyCount, sizeof(polyCount));
+
+        // the asset submesh doesn't match the cached one
+        if (!valid || vertexCount != subMeshes[i]->vertices.size() || polyCount != subMeshes[i]->faces.size()) { return false; }
+
+        outProgMeshes[i].vertexCount = vertexCount;
+        outProgMeshes[i].polyCount = polyCount;
+        outProgMeshes[i].permutations.resize(vertexCount);
+        outProgMeshes[i].candidatesMap.resize(vertexCount);
+        outProgMeshes[i].collapseCosts.resize(vertexCount);
+
+        if (vertexCount == 0) { continue; }
+
+        valid = reader.read(outProgMeshes[i].permutations.data(), sizeof(int) * vertexCount) &&
+                reader.read(outProgMeshes[i].candidatesMap.data(), sizeof(int) * vertexCount) &&
+                reader.read(outProgMeshes[i].collapseCosts.data(), sizeof(float) * vertexCount);
+
+        if (!valid) { return false; }
+
+        // right sizes but stale or corrupt values, generated again
+        if (!validCollapseData(outProgMeshes[i])) {
+            std::cout << "ProgressiveMeshCache " << "rejected corrupt cache file " << cacheFilename(sAssetFilename) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool utils::ProgressiveMeshCache::save(const std::string &sAssetFilename, const unsigned long long key, const std::vector<ProgressiveMesh> &progMeshes)
+{
+    std::string sCacheFilename = cacheFilename(sAssetFilename);
+    std::ofstream file(sCacheFilename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+    if (!file.is_open()) {
+        std::cout << "ProgressiveMeshCache " << "couldn't write cache file " << sCacheFilename << std::endl;
+        return false;
+    }
+
+    unsigned int magic = FILE_MAGIC, version = FILE_VERSION, subMeshCount = progMeshes.size();
+    file.write((const char *)&magic, sizeof(magic));
+    file.write((const char *)&version, sizeof(version));
+    file.write((const char *)&key, sizeof(key));
+
+    if (!writeAssetStamp(file, sAssetFilename)) { return false; }
+
+    file.write((const char *)&subMeshCount, sizeof(subMeshCount));
+
+    for (auto it = progMeshes.begin(); it != progMeshes.end(); ++it) {
+        unsigned int vertexCount = (*it).permutations.size(), polyCount = (*it).polyCount;
+        file.write((const char *)&vertexCount, sizeof(vertexCount));
+        file.write((const char *)&polyCount, sizeof(polyCount));
+
+        if (vertexCount == 0) { continue; }
+
+        file.write((const char *)(*it).permutations.data(), sizeof(int) * vertexCount);
+        file.write((const char *)(*it).candidatesMap.data(), sizeof(int) * vertexCount);
+        file.write((const char *)(*it).collapseCosts.data(), sizeof(float) * vertexCount);
+    }
+
+    return (bool)file;
+}
+
+bool utils::ProgressiveMeshCache::loadLevels(const std::string &sAssetFilename, const unsigned long long key, const std::vector<float> &ratios,
+        const std::vector<scene::Mesh::SubMesh *> &subMeshes, std::vector<ProgressiveMesh::BakedLevels> &outLevels)
+{
+    MappedFile file;
+
+    if (!file.open(levelsFilename(sAssetFilename))) { return false; }
+
+    MappedFile::Reader reader = file.reader();
+    unsigned int magic = 0, version = 0, ratioCount = 0, subMeshCount = 0;
+    unsigned long long storedKey = 0;
+    reader.read(&magic, sizeof(magic));
+    reader.read(&version, sizeof(version));
+    reader.read(&storedKey, sizeof(storedKey));
+
+    if (magic != LEVELS_FILE_MAGIC || version != LEVELS_FILE_VERSION || storedKey != key || !readAssetStamp(reader, sAssetFilename)) { return false; }
+
+    if (!reader.read(&ratioCount, sizeof(ratioCount)) || ratioCount != ratios.size()) { return false; }
+
+    std::vector<float> storedRatios(ratioCount);
+
+    if (ratioCount > 0 && !reader.read(storedRatios.data(), sizeof(float) * ratioCount)) { return false; }
+
+    // levels baked for other ratios
+    if (storedRatios != ratios || !reader.read(&subMeshCount, sizeof(subMeshCount)) || subMeshCount != subMeshes.size()) { return false; }
+
+    outLevels.resize(subMeshCount);
+
+    for (unsigned int i = 0; i < subMeshCount; i++) {
+        unsigned int fullIndexCount = 0, levelCount = 0, indexCount = 0;
+        bool valid = reader.read(&fullIndexCount, sizeof(fullIndexCount)) && reader.read(&levelCount, sizeof(levelCount)) && reader.read(&indexCount, sizeof(indexCount));
+
+        // the asset submesh doesn't match the baked one
+        if (!valid || fullIndexCount != subMeshes[i]->indices.size() || levelCount != ratioCount) { return false; }
+
+        outLevels[i].vertexCounts.resize(levelCount);
+        outLevels[i].ranges.resize(levelCount);
+        outLevels[i].indices.resize(indexCount);
+
+        if (levelCount > 0) {
+            valid = reader.read(outLevels[i].vertexCounts.data(), sizeof(unsigned int) * levelCount) &&
+                    reader.read(outLevels[i].ranges.data(), sizeof(scene::Mesh::SubMesh::IndexRange) * levelCount);
+        }
+
+        if (valid && indexCount > 0) { valid = reader.read(outLevels[i].indices.data(), sizeof(unsigned int) * indexCount); }
+
+        if (!valid) { return false; }
+
+        // right sizes but stale or corrupt values, baked again
+        if (!validLevels(outLevels[i], ratios, subMeshes[i]->vertices.size(), fullIndexCount)) {
+            std::cout << "ProgressiveMeshCache " << "rejected corrupt levels file " << levelsFilename(sAssetFilename) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool utils::ProgressiveMeshCache::saveLevels(const std::string &sAssetFilename, const unsigned long long key, const std::vector<float> &ratios,
+        const std::vector<scene::Mesh::SubMesh *> &subMeshes, const std::vector<ProgressiveMesh::BakedLevels> &levels)
+{
+    if (levels.size() != subMeshes.size()) { return false; }
+
+    std::string sLevelsFilename = levelsFilename(sAssetFilename);
+    std::ofstream file(sLevelsFilename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+    if (!file.is_open()) {
+        std::cout << "ProgressiveMeshCache " << "couldn't write levels file " << sLevelsFilename << std::endl;
+        return false;
+    }
+
+    unsigned int magic = LEVELS_FILE_MAGIC, version = LEVELS_FILE_VERSION, ratioCount = ratios.size(), subMeshCount = levels.size();
+    file.write((const char *)&magic, sizeof(magic));
+    file.write((const char *)&version, sizeof(version));
+    file.write((const char *)&key, sizeof(key));
+
+    if (!writeAssetStamp(file, sAssetFilename)) { return false; }
+
+    file.write((const char *)&ratioCount, sizeof(ratioCount));
+
+    if (ratioCount > 0) { file.write((const char *)ratios.data(), sizeof(float) * ratioCount); }
+
+    file.write((const char *)&subMeshCount, sizeof(subMeshCount));
+
+    for (unsigned int i = 0; i < subMeshCount; i++) {
+        unsigned int fullIndexCount = subMeshes[i]->indices.size(), levelCount = levels[i].ranges.size(), indexCount = levels[i].indices.size();
+        file.write((const char *)&fullIndexCount, sizeof(fullIndexCount));
+        file.write((const char *)&levelCount, sizeof(levelCount));
+        file.write((const char *)&indexCount, sizeof(indexCount));
+
+        if (levelCount > 0) {
+            file.write((const char *)levels[i].vertexCounts.data(), sizeof(unsigned int) * levelCount);
+            file.write((const char *)levels[i].ranges.data(), sizeof(scene::Mesh::SubMesh::IndexRange) * levelCount);
+        }
+
+        if (indexCount > 0) { file.write((const char *)levels[i].indices.data(), sizeof(unsigned int) * indexCount); }
+    }
+
+    return (bool)file;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "ProgressiveMeshes.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+    // binary sidecar file next to an asset storing its progressive meshes collapse
+    // data, valid while the asset contents and the generation options don't change,
+    // the asset size and modification time are checked first, its contents hash only
+    // if it was touched, the sidecars are read through a file mapping
+    class ProgressiveMeshCache {
+        public:
+            // fnv-1a 64 bits hash of the file contents, 0 if the file can't be read
+            static unsigned long long contentHash(const std::string &sFilename);
+            // cache key from the import flags, the collapse cost and the vertex clustering
+            // grid resolution the meshes were generated over, if any
+            static unsigned long long cacheKey(const unsigned int importFlags, const CollapseCost costFunction, const unsigned int clusterGridResolution = 0);
+            // sidecar file location for the given asset
+            static std::string cacheFilename(const std::string &sAssetFilename);
+            // fills outProgMeshes (one per submesh) with the cached data, only succeeds if the
+            // stored key and the vertex and face counts of every submesh match and the collapse
+            // data indexes inside its submesh, on failure
+            // outProgMeshes may be partially written and need to be generated again
+            static bool load(const std::string &sAssetFilename, const unsigned long long key, const std::vector<scene::Mesh::SubMesh *> &subMeshes,
+                             std::vector<ProgressiveMesh> &outProgMeshes);
+            // writes the progressive meshes data, generateProgressiveMesh has to be called before
+            static bool save(const std::string &sAssetFilename, const unsigned long long key, const std::vector<ProgressiveMesh> &progMeshes);
+            // baked levels sidecar, same key as the collapse data plus the level ratios, fills
+            // outLevels (one per submesh), only succeeds if every submesh index count matches and
+            // the levels stay inside its vertices and indices
+            static bool loadLevels(const std::string &sAssetFilename, const unsigned long long key, const std::vector<float> &ratios,
+                                   const std::vector<scene::Mesh::SubMesh *> &subMeshes, std::vector<ProgressiveMesh::BakedLevels> &outLevels);
+            static bool saveLevels(const std::string &sAssetFilename, const unsigned long long key, const std::vector<float> &ratios,
+                                   const std::vector<scene::Mesh::SubMesh *> &subMeshes, const std::vector<ProgressiveMesh::BakedLevels> &levels);
+            // baked levels sidecar location for the given asset
+            static std::string levelsFilename(const std::string &sAssetFilename);
+
+        private:
+            static const unsigned int FILE_MAGIC = 0x4d504754; // "TGPM"
+            static const unsigned int FILE_VERSION = 3;
+            static const char *FILE_EXTENSION;
+            static const unsigned int LEVELS_FILE_MAGIC = 0x4c504754; // "TGPL"
+            static const unsigned int LEVELS_FILE_VERSION = 2;
+            static const char *LEVELS_FILE_EXTENSION;
+            // asset size, modification time and contents hash after the key
+            static bool writeAssetStamp(std::ofstream &file, const std::string &sAssetFilename);
+            // true if the asset is the one the sidecar was written for
+            static bool readAssetStamp(MappedFile::Reader &reader, const std::string &sAssetFilename);
+    };
+}
+
@@ -0,0 +1,425 @@
+#include "ProgressiveMeshStream.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+using namespace utils;
+
+const char *utils::ProgressiveMeshStream::FILE_EXTENSION = ".pmstream";
+
+// header fields per submesh, vertex, poly, base vertex and base poly counts plus bounds
+static const unsigned int SUBMESH_HEADER_SIZE = sizeof(unsigned int) * 4 + sizeof(float) * 6;
+// submesh index, split count and byte size before every batch
+static const unsigned int BATCH_HEADER_SIZE = sizeof(unsigned int) * 3;
+
+static void writeUint(std::vector<char> &out, const unsigned int value)
+{
+    out.insert(out.end(), (const char *)&value, (const char *)&value + sizeof(value));
+}
+
+static unsigned int readUint(const std::vector<char> &in, const size_t offset)
+{
+    unsigned int value;
+    memcpy(&value, &in[offset], sizeof(value));
+    return value;
+}
+
+// collapse candidate, out of order candidates go to the root like a missing one
+static unsigned int candidateOf(const std::vector<int> &candidatesMap, const unsigned int v)
+{
+    return v > 0 && candidatesMap[v] >= 0 && (unsigned int)candidatesMap[v] < v ? candidatesMap[v] : 0;
+}
+
+static bool isDegenerate(const unsigned int *corners)
+{
+    return corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0];
+}
+
+bool utils::ProgressiveMeshStream::save(const std::string &sFilename, const std::vector<scene::Mesh::SubMesh *> &subMeshes,
+                                        const std::vector<ProgressiveMesh> &progMeshes, const unsigned int baseVertexCount /* = BASE_VERTEX_COUNT */)
+{
+    const unsigned int subMeshCount = subMeshes.size();
+
+    if (progMeshes.size() != subMeshCount) { return false; }
+
+    std::vector<char> header, baseMeshes;
+    // every submesh splits concatenated, splitOffsets[i][s] is where split s starts
+    std::vector<std::vector<char> > splits(subMeshCount);
+    std::vector<std::vector<size_t> > splitOffsets(subMeshCount);
+    writeUint(header, FILE_MAGIC);
+    writeUint(header, FILE_VERSION);
+    writeUint(header, subMeshCount);
+
+    for (unsigned int i = 0; i < subMeshCount; i++) {
+        const std::vector<types::Vertex> &vertices = subMeshes[i]->vertices;
+        const std::vector<unsigned int> &indices = subMeshes[i]->indices;
+        const std::vector<int> &candidatesMap = progMeshes[i].candidatesMap;
+        const unsigned int vertexCount = vertices.size();
+        const unsigned int faceCount = indices.size() / 3;
+
+        if (candidatesMap.size() != vertexCount) { return false; }
+
+        const unsigned int baseCount = std::min(baseVertexCount, vertexCount);
+        // vertex count a face shows up at, collapsing down to its birth - 1
+        // vertices degenerates it, 0 for faces degenerate from the start
+        std::vector<unsigned int> births(faceCount, 0);
+
+        for (unsigned int f = 0; f < faceCount; f++) {
+            unsigned int corners[3] = { indices[f * 3], indices[f * 3 + 1], indices[f * 3 + 2] };
+
+            if (isDegenerate(corners)) { continue; }
+
+            // removes the highest corner vertex until two corners meet
+            while (!isDegenerate(corners)) {
+                unsigned int highest = std::max(std::max(corners[0], corners[1]), corners[2]);
+
+                for (int j = 0; j < 3; j++) { corners[j] = corners[j] == highest ? candidateOf(candidatesMap, highest) : corners[j]; }
+
+                births[f] = highest + 1;
+            }
+        }
+
+        // base faces first, the rest by birth, so each split brings back a contiguous range
+        std::vector<unsigned int> levelStart(vertexCount + 2, 0);
+        std::vector<unsigned int> order(faceCount);
+        unsigned int polyCount = 0;
+
+        for (unsigned int f = 0; f < faceCount; f++) {
+            if (births[f] > 0) { levelStart[std::max(births[f], baseCount) + 1]++; polyCount++; }
+        }
+
+        for (unsigned int l = 1; l < levelStart.size(); l++) { levelStart[l] += levelStart[l - 1]; }
+
+        std::vector<unsigned int> cursors(levelStart.begin(), levelStart.end() - 1);
+
+        for (unsigned int f = 0; f < faceCount; f++) {
+            if (births[f] > 0) { order[cursors[std::max(births[f], baseCount)]++] = f; }
+        }
+
+        // corners a split moves to its vertex, every chain vertex still missing when the face shows up
+        std::vector<unsigned int> moveStart(vertexCount + 1, 0);
+        std::vector<unsigned int> moves;
+
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                for (unsigned int v = 1; v <= vertexCount; v++) { moveStart[v] += moveStart[v - 1]; }
+
+                moves.resize(moveStart[vertexCount]);
+                cursors.assign(moveStart.begin(), moveStart.end() - 1);
+            }
+
+            for (unsigned int id = 0; id < polyCount; id++) {
+                const unsigned int f = order[id];
+                const unsigned int level = std::max(births[f], baseCount);
+
+                for (unsigned int j = 0; j < 3; j++) {
+                    for (unsigned int v = indices[f * 3 + j]; v >= level; v = candidateOf(candidatesMap, v)) {
+                        if (pass == 0) { moveStart[v + 1]++; }
+                        else { moves[cursors[v]++] = id * 3 + j; }
+                    }
+                }
+            }
+        }
+
+        writeUint(header, vertexCount);
+        writeUint(header, polyCount);
+        writeUint(header, baseCount);
+        writeUint(header, levelStart[baseCount + 1]);
+        header.insert(header.end(), (const char *)&subMeshes[i]->getMinPoint(), (const char *)&subMeshes[i]->getMinPoint() + sizeof(float) * 3);
+        header.insert(header.end(), (const char *)&subMeshes[i]->getMaxPoint(), (const char *)&subMeshes[i]->getMaxPoint() + sizeof(float) * 3);
+
+        // faces as they are drawn when they show up
+        auto writeFaces = [&](std::vector<char> &out, const unsigned int first, const unsigned int last) {
+            for (unsigned int id = first; id < last; id++) {
+                const unsigned int level = std::max(births[order[id]], baseCount);
+
+                for (unsigned int j = 0; j < 3; j++) {
+                    unsigned int v = indices[order[id] * 3 + j];
+
+                    while (v >= level) { v = candidateOf(candidatesMap, v); }
+
+                    writeUint(out, v);
+                }
+            }
+        };
+
+        if (baseCount > 0) { baseMeshes.insert(baseMeshes.end(), (const char *)&vertices[0], (const char *)(&vertices[0] + baseCount)); }
+
+        writeFaces(baseMeshes, 0, levelStart[baseCount + 1]);
+
+        for (unsigned int v = baseCount; v < vertexCount; v++) {
+            splitOffsets[i].push_back(splits[i].size());
+            splits[i].insert(splits[i].end(), (const char *)&vertices[v], (const char *)(&vertices[v] + 1));
+            writeUint(splits[i], levelStart[v + 2] - levelStart[v + 1]);
+            writeFaces(splits[i], levelStart[v + 1], levelStart[v + 2]);
+            writeUint(splits[i], moveStart[v + 1] - moveStart[v]);
+            splits[i].insert(splits[i].end(), (const char *)(moves.data() + moveStart[v]), (const char *)(moves.data() + moveStart[v + 1]));
+        }
+
+        splitOffsets[i].push_back(splits[i].size());
+    }
+
+    std::ofstream file(sFilename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+    if (!file.is_open()) {
+        std::cout << "ProgressiveMeshStream " << "couldn't write stream file " << sFilename << std::endl;
+        return false;
+    }
+
+    file.write(header.data(), header.size());
+    file.write(baseMeshes.data(), baseMeshes.size());
+    size_t totalSplits = 0;
+
+    for (unsigned int i = 0; i < subMeshCount; i++) { totalSplits += splitOffsets[i].size() - 1; }
+
+    // every submesh writes the same fraction of its splits each round
+    const size_t rounds = (totalSplits + BATCH_SPLITS - 1) / BATCH_SPLITS;
+    std::vector<size_t> written(subMeshCount, 0);
+
+    for (size_t round = 0; round < rounds; round++) {
+        for (unsigned int i = 0; i < subMeshCount; i++) {
+            const size_t splitCount = splitOffsets[i].size() - 1;
+            const size_t batch = std::min((splitCount + rounds - 1) / rounds, splitCount - written[i]);
+
+            if (batch == 0) { continue; }
+
+            const size_t first = splitOffsets[i][written[i]], last = splitOffsets[i][written[i] + batch];
+            const unsigned int batchHeader[3] = { i, (unsigned int)batch, (unsigned int)(last - first) };
+            file.write((const char *)batchHeader, sizeof(batchHeader));
+            file.write(&splits[i][first], last - first);
+            written[i] += batch;
+        }
+    }
+
+    return (bool)file;
+}
+
+bool utils::ProgressiveMeshStream::isStreamFile(const std::string &sFilename)
+{
+    const std::string extension(FILE_EXTENSION);
+    return sFilename.size() >= extension.size() && sFilename.compare(sFilename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+utils::ProgressiveMeshStream::~ProgressiveMeshStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->readMutex);
+        this->readExit = true;
+    }
+
+    if (this->reader.joinable()) { this->reader.join(); }
+}
+
+bool utils::ProgressiveMeshStream::open(const std::string &sFilename)
+{
+    if (this->reader.joinable() || !std::ifstream(sFilename, std::ifstream::in | std::ifstream::binary).is_open()) { return false; }
+
+    this->reader = std::thread(&ProgressiveMeshStream::readFile, this, sFilename);
+    return true;
+}
+
+void utils::ProgressiveMeshStream::readFile(const std::string sFilename)
+{
+    std::ifstream file(sFilename, std::ifstream::in | std::ifstream::binary);
+    std::vector<char> chunk(READ_CHUNK_SIZE);
+
+    while (file.is_open() && file) {
+        file.read(chunk.data(), chunk.size());
+        std::lock_guard<std::mutex> lock(this->readMutex);
+        this->incoming.insert(this->incoming.end(), chunk.begin(), chunk.begin() + (size_t)file.gcount());
+
+        if (this->readExit) { return; }
+    }
+
+    std::lock_guard<std::mutex> lock(this->readMutex);
+    this->readFinished = true;
+    this->readFailed = !file.eof();
+}
+
+bool utils::ProgressiveMeshStream::isComplete() const
+{
+    if (this->failed) { return true; }
+
+    if (!this->headerRead || this->section < this->subMeshesInfo.size()) { return false; }
+
+    for (auto it = this->subMeshesInfo.begin(); it != this->subMeshesInfo.end(); ++it) {
+        if ((*it).receivedVertices < (*it).vertexCount) { return false; }
+    }
+
+    return true;
+}
+
+bool utils::ProgressiveMeshStream::update(const std::vector<scene::Mesh::SubMesh *> &subMeshes)
+{
+    if (this->failed) { return false; }
+
+    bool finished = false;
+    {
+        std::lock_guard<std::mutex> lock(this->readMutex);
+        this->received.insert(this->received.end(), this->incoming.begin(), this->incoming.end());
+        this->incoming.clear();
+        finished = this->readFinished;
+        this->failed = this->readFailed;
+    }
+    bool changed = false;
+
+    // the submeshes come from the header counts
+    if (!this->headerRead) {
+        changed = this->parseHeader();
+    } else if (subMeshes.size() == this->subMeshesInfo.size()) {
+        for (auto it = this->subMeshesInfo.begin(); it != this->subMeshesInfo.end(); ++it) {
+            (*it).changedVertex = (*it).vertexCount;
+            (*it).changedIndex = (*it).polyCount * 3;
+        }
+
+        while (this->section < subMeshes.size() && this->parseBaseMesh(subMeshes[this->section], this->subMeshesInfo[this->section])) {
+            this->section++;
+            changed = true;
+        }
+
+        while (this->section == subMeshes.size() && this->parseBatch(subMeshes)) { changed = true; }
+    }
+
+    // only the bytes of sections still arriving stay
+    this->received.erase(this->received.begin(), this->received.begin() + this->parseOffset);
+    this->parseOffset = 0;
+
+    // the whole file is here and some part of it is missing or wrong
+    if (finished && this->headerRead && !this->isComplete() && !changed) { this->failed = true; }
+
+    if (finished && !this->headerRead) { this->failed = true; }
+
+    if (this->failed) { std::cout << "ProgressiveMeshStream(" << this << ") " << "stream truncated or malformed" << std::endl; }
+
+    return changed;
+}
+
+bool utils::ProgressiveMeshStream::parseHeader()
+{
+    const size_t available = this->received.size() - this->parseOffset;
+
+    if (available < sizeof(unsigned int) * 3) { return false; }
+
+    const unsigned int subMeshCount = readUint(this->received, this->parseOffset + sizeof(unsigned int) * 2);
+
+    if (readUint(this->received, this->parseOffset) != FILE_MAGIC || readUint(this->received, this->parseOffset + sizeof(unsigned int)) != FILE_VERSION) {
+        this->failed = true;
+        return false;
+    }
+
+    if (available < sizeof(unsigned int) * 3 + (size_t)SUBMESH_HEADER_SIZE * subMeshCount) { return false; }
+
+    size_t offset = this->parseOffset + sizeof(unsigned int) * 3;
+    this->subMeshesInfo.resize(subMeshCount);
+
+    for (auto it = this->subMeshesInfo.begin(); it != this->subMeshesInfo.end(); ++it, offset += SUBMESH_HEADER_SIZE) {
+        (*it).vertexCount = readUint(this->received, offset);
+        (*it).polyCount = readUint(this->received, offset + sizeof(unsigned int));
+        (*it).baseVertexCount = readUint(this->received, offset + sizeof(unsigned int) * 2);
+        (*it).basePolyCount = readUint(this->received, offset + sizeof(unsigned int) * 3);
+        memcpy(&(*it).minPoint, &this->received[offset + sizeof(unsigned int) * 4], sizeof(float) * 3);
+        memcpy(&(*it).maxPoint, &this->received[offset + sizeof(unsigned int) * 4 + sizeof(float) * 3], sizeof(float) * 3);
+        (*it).receivedVertices = (*it).receivedFaces = 0;
+        (*it).changedVertex = (*it).vertexCount;
+        (*it).changedIndex = (*it).polyCount * 3;
+
+        if ((*it).baseVertexCount > (*it).vertexCount || (*it).basePolyCount > (*it).polyCount) { this->failed = true; return false; }
+    }
+
+    this->parseOffset = offset;
+    this->headerRead = true;
+    return true;
+}
+
+bool utils::ProgressiveMeshStream::parseBaseMesh(scene::Mesh::SubMesh *subMesh, SubMeshInfo &info)
+{
+    const size_t verticesSize = sizeof(types::Vertex) * info.baseVertexCount;
+    const size_t size = verticesSize + sizeof(unsigned int) * 3 * info.basePolyCount;
+
+    if (this->received.size() - this->parseOffset < size) { return false; }
+
+    // splits only append, the face vertex pointers built at the end stay valid
+    subMesh->vertices.reserve(info.vertexCount);
+    subMesh->indices.reserve(info.polyCount * 3);
+    subMesh->vertices.resize(info.baseVertexCount);
+    subMesh->indices.resize(info.basePolyCount * 3);
+
+    if (verticesSize > 0) { memcpy(&subMesh->vertices[0], &this->received[this->parseOffset], verticesSize); }
+
+    for (unsigned int i = 0; i < info.basePolyCount * 3; i++) {
+        subMesh->indices[i] = readUint(this->received, this->parseOffset + verticesSize + sizeof(unsigned int) * i);
+
+        if (subMesh->indices[i] >= info.baseVertexCount) { this->failed = true; return false; }
+    }
+
+    this->parseOffset += size;
+    info.receivedVertices = info.baseVertexCount;
+    info.receivedFaces = info.basePolyCount;
+    info.changedVertex = info.changedIndex = 0;
+    return true;
+}
+
+bool utils::ProgressiveMeshStream::parseBatch(const std::vector<scene::Mesh::SubMesh *> &subMeshes)
+{
+    if (this->received.size() - this->parseOffset < BATCH_HEADER_SIZE) { return false; }
+
+    const unsigned int subMeshIndex = readUint(this->received, this->parseOffset);
+    const unsigned int splitCount = readUint(this->received, this->parseOffset + sizeof(unsigned int));
+    const unsigned int batchSize = readUint(this->received, this->parseOffset + sizeof(unsigned int) * 2);
+
+    if (subMeshIndex >= subMeshes.size()) { this->failed = true; return false; }
+
+    if (this->received.size() - this->parseOffset - BATCH_HEADER_SIZE < batchSize) { return false; }
+
+    scene::Mesh::SubMesh *subMesh = subMeshes[subMeshIndex];
+    SubMeshInfo &info = this->subMeshesInfo[subMeshIndex];
+    size_t offset = this->parseOffset + BATCH_HEADER_SIZE;
+    const size_t end = offset + batchSize;
+    // batches are validated as they go, a wrong one stops the stream where it is
+    auto fits = [&](const size_t bytes) { return end - offset >= bytes; };
+
+    for (unsigned int s = 0; s < splitCount; s++) {
+        if (info.receivedVertices >= info.vertexCount || !fits(sizeof(types::Vertex) + sizeof(unsigned int))) { this->failed = true; return false; }
+
+        const unsigned int v = info.receivedVertices;
+        subMesh->vertices.push_back(types::Vertex());
+        memcpy(&subMesh->vertices.back(), &this->received[offset], sizeof(types::Vertex));
+        offset += sizeof(types::Vertex);
+        info.changedVertex = std::min(info.changedVertex, v);
+        info.receivedVertices++;
+        // faces this split brings back
+        const unsigned int faceCount = readUint(this->received, offset);
+        offset += sizeof(unsigned int);
+
+        if (faceCount > info.polyCount - info.receivedFaces || !fits(sizeof(unsigned int) * (3 * (size_t)faceCount + 1))) { this->failed = true; return false; }
+
+        info.changedIndex = std::min(info.changedIndex, info.receivedFaces * 3);
+
+        for (unsigned int i = 0; i < faceCount * 3; i++, offset += sizeof(unsigned int)) {
+            subMesh->indices.push_back(readUint(this->received, offset));
+
+            if (subMesh->indices.back() > v) { this->failed = true; return false; }
+        }
+
+        info.receivedFaces += faceCount;
+        // corners moving from an ancestor to the split vertex
+        const unsigned int moveCount = readUint(this->received, offset);
+        offset += sizeof(unsigned int);
+
+        if (!fits(sizeof(unsigned int) * (size_t)moveCount)) { this->failed = true; return false; }
+
+        for (unsigned int i = 0; i < moveCount; i++, offset += sizeof(unsigned int)) {
+            const unsigned int corner = readUint(this->received, offset);
+
+            if (corner >= subMesh->indices.size()) { this->failed = true; return false; }
+
+            subMesh->indices[corner] = v;
+            info.changedIndex = std::min(info.changedIndex, corner);
+        }
+    }
+
+    if (offset != end) { this->failed = true; return false; }
+
+    this->parseOffset = end;
+    return true;
+}
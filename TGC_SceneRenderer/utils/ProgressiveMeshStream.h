@@ -0,0 +1,86 @@
+#pragma once
+#include "ProgressiveMeshes.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+    // streaming progressive mesh file, every submesh base mesh comes first and then its
+    // vertex splits in reverse collapse order, each split adds its vertex, the faces it
+    // brings back and the face corners that move to it, batches of splits of every
+    // submesh interleave so all of them refine together while the file arrives
+    class ProgressiveMeshStream {
+        public:
+            // known once the file header arrives
+            struct SubMeshInfo {
+                unsigned int vertexCount;
+                unsigned int polyCount;
+                unsigned int baseVertexCount;
+                unsigned int basePolyCount;
+                glm::vec3 minPoint;
+                glm::vec3 maxPoint;
+                // vertices and faces received so far
+                unsigned int receivedVertices;
+                unsigned int receivedFaces;
+                // lowest vertex and index changed by the last update, pending upload
+                unsigned int changedVertex;
+                unsigned int changedIndex;
+            };
+
+            ProgressiveMeshStream() : readExit(false), readFinished(false), readFailed(false), failed(false), headerRead(false), section(0), parseOffset(0) {};
+            ~ProgressiveMeshStream();
+
+            // writes the submeshes with their progressive meshes, one per submesh, the submeshes
+            // have to be permuted by them, baseVertexCount vertices per submesh in the base meshes
+            static bool save(const std::string &sFilename, const std::vector<scene::Mesh::SubMesh *> &subMeshes, const std::vector<ProgressiveMesh> &progMeshes,
+                             const unsigned int baseVertexCount = BASE_VERTEX_COUNT);
+            // true if the file has the stream extension
+            static bool isStreamFile(const std::string &sFilename);
+
+            // starts reading the file on a background thread
+            bool open(const std::string &sFilename);
+            // parses the sections that fully arrived into subMeshes vertices and indices, the
+            // submeshes have to be created with the header counts once hasHeader, true if
+            // anything changed, see SubMeshInfo changed ranges, gl thread only
+            bool update(const std::vector<scene::Mesh::SubMesh *> &subMeshes);
+            bool hasHeader() const { return headerRead; }
+            // every split arrived, or the stream failed and won't refine any further
+            bool isComplete() const;
+            bool hasFailed() const { return failed; }
+            const std::vector<SubMeshInfo> &getSubMeshesInfo() const { return subMeshesInfo; }
+
+        private:
+            static const unsigned int FILE_MAGIC = 0x53504754; // "TGPS"
+            static const unsigned int FILE_VERSION = 1;
+            static const char *FILE_EXTENSION;
+            // base mesh vertices per submesh, a few KB of data
+            static const unsigned int BASE_VERTEX_COUNT = 64;
+            // splits per batch, every submesh writes its share of each round
+            static const unsigned int BATCH_SPLITS = 256;
+            // bytes the reader thread asks for at once
+            static const unsigned int READ_CHUNK_SIZE = 1 << 14;
+
+            // reader thread, appends to incoming what arrived since the last update
+            std::thread reader;
+            std::mutex readMutex;
+            bool readExit;
+            bool readFinished;
+            bool readFailed;
+            std::vector<char> incoming;
+            void readFile(const std::string sFilename);
+
+            // parser state, received holds the bytes of sections not fully arrived yet
+            bool failed;
+            bool headerRead;
+            // base meshes parsed, batches come after subMeshCount of them
+            unsigned int section;
+            std::vector<char> received;
+            size_t parseOffset;
+            std::vector<SubMeshInfo> subMeshesInfo;
+            bool parseHeader();
+            bool parseBaseMesh(scene::Mesh::SubMesh *subMesh, SubMeshInfo &info);
+            bool parseBatch(const std::vector<scene::Mesh::SubMesh *> &subMeshes);
+    };
+}
@@ -1,88 +1,91 @@
 #include "ProgressiveMeshes.h"
+#include "ProgressiveMeshCache.h"
+#include "ProgressiveMeshStream.h"
 #include "..\core\Data.h"
+#include "..\collections\stored\StoredShaders.h"
 #include "glm\gtc\quaternion.hpp"
 #include "glm\gtc\constants.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <thread>
 using namespace utils;
 
-bool utils::ProgressiveMesh::Face::replaceVertex(std::unordered_map<unsigned int, utils::ProgressiveMesh::Face *>::iterator &it, Vertex *oldVertex, Vertex *newVertex,
-        const bool calcNormal /* = true */)
+unsigned int *utils::ProgressiveMesh::IndexArena::allocate(const unsigned int count)
 {
-    if (!(oldVertex && newVertex) || !this->hasVertex(oldVertex) || this->hasVertex(newVertex)) { return false; }
-
-    if (oldVertex == vertices[0]) {
-        vertices[0] = newVertex;
-    } else if (oldVertex == vertices[1]) {
-        vertices[1] = newVertex;
-    } else if (oldVertex == vertices[2]) {
-        vertices[2] = newVertex;
+    // requests bigger than a chunk get their own chunk
+    if (count > CHUNK_SIZE) {
+        chunks.push_back(std::vector<unsigned int>(count));
+        return chunks.back().data();
     }
 
-    // erase in the old vertex this face association
-    it = oldVertex->faces.erase(oldVertex->faces.find(this->mappingId));
+    if (chunkUsed + count > CHUNK_SIZE) {
+        chunks.push_back(std::vector<unsigned int>(CHUNK_SIZE));
+        current = chunks.back().data();
+        chunkUsed = 0;
+    }
 
-    // add to the new vertex this face as an associate
-    if (newVertex->faces.find(this->mappingId) != newVertex->faces.end()) { return false; }
+    unsigned int *result = current + chunkUsed;
+    chunkUsed += count;
+    return result;
+}
 
-    newVertex->faces[this->mappingId] = this;
-    // remove non-neighbors
-    std::for_each(this->vertices.begin(), this->vertices.end(), [oldVertex](Vertex * vertex) {
-        oldVertex->removeNonNeighbor(vertex);
-        vertex->removeNonNeighbor(oldVertex);
-    });
+void utils::ProgressiveMesh::IndexArena::release()
+{
+    std::vector<std::vector<unsigned int> >().swap(chunks);
+    current = nullptr;
+    chunkUsed = CHUNK_SIZE;
+}
 
-    // update face vertices neighbors
-    for (unsigned int i = 0; i < 3; i++) {
-        if (this->vertices[i]->faces.find(this->mappingId) == this->vertices[i]->faces.end()) { return true; }
+size_t utils::ProgressiveMesh::IndexArena::reservedBytes() const
+{
+    size_t bytes = 0;
 
-        for (unsigned int j = 0; j < 3; j++) {
-            if (j != i) {
-                if (this->vertices[i]->neightbors.find(this->vertices[j]->mappingId) == this->vertices[i]->neightbors.end()) {
-                    this->vertices[i]->neightbors[this->vertices[j]->mappingId] = this->vertices[j];
-                }
-            }
-        }
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        bytes += (*it).capacity() * sizeof(unsigned int);
     }
 
-    // recalculate face normal
-    if (calcNormal) { this->calculateNormal(); }
-
-    return true;
+    return bytes;
 }
 
-utils::ProgressiveMesh::Face::Face(const unsigned int id, Vertex *v1, Vertex *v2, Vertex *v3, const types::Face &nonProgFace) : types::Face(nonProgFace)
+bool utils::ProgressiveMesh::IndexList::contains(const unsigned int value) const
 {
-    this->mappingId = id;
-    this->vertices[0] = v1;
-    this->vertices[1] = v2;
-    this->vertices[2] = v3;
-    // calculate face normal
-    this->calculateNormal();
-
-    // add associate face vertices with this face
-    for (int i = 0; i < 3; i++) {
-        this->vertices[i]->faces[this->mappingId] = this;
+    return std::find(begin(), end(), value) != end();
+}
 
-        // associate vertices neighbors
-        for (int j = 0; j < 3; j++) {
-            if (i != j) { this->vertices[i]->neightbors[this->vertices[j]->mappingId] = this->vertices[j]; }
-        }
+void utils::ProgressiveMesh::IndexList::push(const unsigned int value, IndexArena &arena)
+{
+    if (count == capacity) {
+        // move to a twice as big arena block, the old block
+        // is reclaimed when the whole arena is released
+        unsigned int *grown = arena.allocate(capacity * 2);
+        std::copy(begin(), end(), grown);
+        overflow = grown;
+        capacity *= 2;
     }
+
+    (overflow ? overflow : items)[count++] = value;
 }
 
-utils::ProgressiveMesh::Vertex::Vertex(const unsigned int id, const types::Vertex &nonProgVert) : types::Vertex(nonProgVert)
+void utils::ProgressiveMesh::IndexList::erase(const unsigned int value)
 {
-    this->mappingId = id;
-    this->originalPlace = id;
+    unsigned int *data = overflow ? overflow : items;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (data[i] == value) {
+            data[i] = data[--count];
+            return;
+        }
+    }
 }
 
-void utils::ProgressiveMesh::Face::calculateNormal()
+void utils::ProgressiveMesh::calculateFaceNormal(const unsigned int face)
 {
-    glm::vec3 v0 = this->vertices[0]->position;
-    glm::vec3 v1 = this->vertices[1]->position;
-    glm::vec3 v2 = this->vertices[2]->position;
+    glm::vec3 v0 = this->vertexPositions[this->faceVertices[face][0]];
+    glm::vec3 v1 = this->vertexPositions[this->faceVertices[face][1]];
+    glm::vec3 v2 = this->vertexPositions[this->faceVertices[face][2]];
+    glm::vec3 &normal = this->faceNormals[face];
     normal = (v1 - v0) * (v2 - v1);
 
     if (glm::length(normal) == 0) { return; }
@@ -90,56 +93,132 @@ void utils::ProgressiveMesh::Face::calculateNormal()
     normal = glm::normalize(normal);
 }
 
-bool utils::ProgressiveMesh::Face::hasVertex(types::Vertex *v)
+bool utils::ProgressiveMesh::faceHasVertex(const unsigned int face, const unsigned int v) const
 {
-    return (v == vertices[0] || v == vertices[1] || v == vertices[2]);
+    const std::array<unsigned int, 3> &fv = this->faceVertices[face];
+    return (v == fv[0] || v == fv[1] || v == fv[2]);
 }
 
-void utils::ProgressiveMesh::Vertex::removeNonNeighbor(Vertex *v)
+void utils::ProgressiveMesh::updateNeighbors(const unsigned int v)
 {
-    // this vertex isn't stored
-    if (this->neightbors.find(v->mappingId) == this->neightbors.end()) { return; }
+    IndexList &neighbors = this->vertexNeighbors[v];
+    neighbors.clear();
 
-    for (auto it = this->faces.begin(); it != this->faces.end(); ++it) {
-        if ((*it).second->hasVertex(v)) { return; }
+    // neighbors are the vertices sharing at least one face with v
+    for (auto it = this->vertexFaces[v].begin(); it != this->vertexFaces[v].end(); ++it) {
+        for (int i = 0; i < 3; i++) {
+            unsigned int neighbor = this->faceVertices[*it][i];
+
+            if (neighbor != v && !neighbors.contains(neighbor)) { neighbors.push(neighbor, this->adjacencyArena); }
+        }
     }
+}
 
-    this->neightbors.erase(v->mappingId);
+utils::ProgressiveMesh::Quadric::Quadric() : a2(0.0), ab(0.0), ac(0.0), ad(0.0), b2(0.0), bc(0.0), bd(0.0), c2(0.0), cd(0.0), d2(0.0)
+{
 }
 
-utils::ProgressiveMesh::Vertex::~Vertex()
+utils::ProgressiveMesh::Quadric::Quadric(const glm::vec3 &n, const double d, const double weight)
 {
-    if (this->faces.empty()) { return; }
+    a2 = weight * n.x * n.x; ab = weight * n.x * n.y; ac = weight * n.x * n.z; ad = weight * n.x * d;
+    b2 = weight * n.y * n.y; bc = weight * n.y * n.z; bd = weight * n.y * d;
+    c2 = weight * n.z * n.z; cd = weight * n.z * d;
+    d2 = weight * d * d;
+}
 
-    while (!this->neightbors.empty()) {
-        (*this->neightbors.begin()).second->neightbors.erase(this->mappingId);
-        this->neightbors.erase(this->neightbors.begin());
-    }
+utils::ProgressiveMesh::Quadric &utils::ProgressiveMesh::Quadric::operator+=(const Quadric &q)
+{
+    a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+    b2 += q.b2; bc += q.bc; bd += q.bd;
+    c2 += q.c2; cd += q.cd;
+    d2 += q.d2;
+    return *this;
 }
 
-utils::ProgressiveMesh::Face::~Face()
+double utils::ProgressiveMesh::Quadric::evaluate(const glm::vec3 &p) const
 {
-    this->vertices[0] = nullptr; this->vertices[1] = nullptr; this->vertices[2] = nullptr;
+    // p^T Q p with p = (x, y, z, 1)
+    const double x = p.x, y = p.y, z = p.z;
+    return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+           + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+           + c2 * z * z + 2.0 * cd * z
+           + d2;
 }
 
-float utils::ProgressiveMesh::edgeCollapseCost(Vertex *u, Vertex *v)
+void utils::ProgressiveMesh::computeQuadrics()
 {
-    float edgeLength, curvature = 0.f;
-    edgeLength = glm::length(v->position - u->position);
-    // find faces associated with uv edge
-    std::unordered_map<unsigned int, Face *> sides;
+    this->vertexQuadrics.assign(this->vertexPositions.size(), Quadric());
+
+    for (unsigned int face = 0; face < this->faceVertices.size(); face++) {
+        const std::array<unsigned int, 3> &fv = this->faceVertices[face];
+        const glm::vec3 &p0 = this->vertexPositions[fv[0]];
+        glm::vec3 planeNormal = glm::cross(this->vertexPositions[fv[1]] - p0, this->vertexPositions[fv[2]] - p0);
+        float doubleArea = glm::length(planeNormal);
+
+        // degenerated face, no plane to contribute
+        if (doubleArea <= 0.f) { continue; }
 
-    for (auto it = u->faces.begin(); it != u->faces.end(); ++it) {
-        if ((*it).second->hasVertex(v)) { sides[(*it).first] = (*it).second; }
+        planeNormal /= doubleArea;
+        // area weighted face plane
+        Quadric facePlane(planeNormal, -glm::dot(planeNormal, p0), doubleArea * 0.5);
+
+        for (int i = 0; i < 3; i++) {
+            unsigned int a = fv[i], b = fv[(i + 1) % 3];
+            this->vertexQuadrics[a] += facePlane;
+            // border edges belong to only one face
+            unsigned int edgeFaces = 0;
+
+            for (auto it = this->vertexFaces[a].begin(); it != this->vertexFaces[a].end(); ++it) {
+                if (faceHasVertex(*it, b)) { edgeFaces++; }
+            }
+
+            if (edgeFaces != 1) { continue; }
+
+            // constraint plane through the border edge perpendicular to the face
+            glm::vec3 edge = this->vertexPositions[b] - this->vertexPositions[a];
+            float edgeLength = glm::length(edge);
+
+            if (edgeLength <= 0.f) { continue; }
+
+            glm::vec3 borderNormal = glm::normalize(glm::cross(edge, planeNormal));
+            Quadric borderPlane(borderNormal, -glm::dot(borderNormal, this->vertexPositions[a]), edgeLength * edgeLength);
+            this->vertexQuadrics[a] += borderPlane;
+            this->vertexQuadrics[b] += borderPlane;
+        }
     }
+}
+
+float utils::ProgressiveMesh::edgeCollapseCost(const unsigned int u, const unsigned int v)
+{
+    if (this->costFunction == QuadricErrorMetric) { return quadricCollapseCost(u, v); }
+
+    return curvatureCollapseCost(u, v);
+}
+
+float utils::ProgressiveMesh::quadricCollapseCost(const unsigned int u, const unsigned int v)
+{
+    Quadric edgeQuadric = this->vertexQuadrics[u];
+    edgeQuadric += this->vertexQuadrics[v];
+    // the collapse keeps v so the error is measured at its position,
+    // tiny negative values come from floating point cancellation
+    return (float)std::max(edgeQuadric.evaluate(this->vertexPositions[v]), 0.0);
+}
 
-    // use face facing most away from associated faces
-    for (auto it = u->faces.begin(); it != u->faces.end(); ++it) {
+float utils::ProgressiveMesh::curvatureCollapseCost(const unsigned int u, const unsigned int v)
+{
+    float edgeLength, curvature = 0.f;
+    edgeLength = glm::length(this->vertexPositions[v] - this->vertexPositions[u]);
+    const IndexList &faces = this->vertexFaces[u];
+
+    // use face facing most away from the faces associated with the uv edge
+    for (auto it = faces.begin(); it != faces.end(); ++it) {
         float minCurvature = 1.f;
 
         // determine the minimum normal curvature between faces
-        for (auto itSides = sides.begin(); itSides != sides.end(); itSides++) {
-            float dotProduct = glm::dot((*it).second->normal, (*itSides).second->normal);
+        for (auto itSides = faces.begin(); itSides != faces.end(); ++itSides) {
+            if (!faceHasVertex(*itSides, v)) { continue; }
+
+            float dotProduct = glm::dot(this->faceNormals[*it], this->faceNormals[*itSides]);
             minCurvature = glm::min(minCurvature, (1.f - dotProduct) / 2.f);
         }
 
@@ -149,172 +228,312 @@ float utils::ProgressiveMesh::edgeCollapseCost(Vertex *u, Vertex *v)
     return edgeLength * curvature;
 }
 
-void utils::ProgressiveMesh::edgeCostAtVertex(Vertex *v)
+void utils::ProgressiveMesh::edgeCostAtVertex(const unsigned int v)
 {
-    if (v->neightbors.empty()) {
-        v->collapseCandidate = nullptr;
-        v->collapseCost = 0.01f;
-        return;
-    }
+    const IndexList &neighbors = this->vertexNeighbors[v];
+    float &collapseCost = this->vertexCollapseCost[v];
+    int &collapseCandidate = this->vertexCollapseCandidate[v];
 
-    v->collapseCost = std::numeric_limits<float>::infinity();
-    v->collapseCandidate = nullptr;
+    if (neighbors.empty()) {
+        collapseCandidate = NO_CANDIDATE;
+        collapseCost = 0.01f;
+    } else {
+        collapseCost = std::numeric_limits<float>::infinity();
+        collapseCandidate = NO_CANDIDATE;
 
-    // search for the least cost edge
-    for (auto it = v->neightbors.begin(); it != v->neightbors.end(); ++it) {
-        float currentCost = edgeCollapseCost(v, (*it).second);
+        // search for the least cost edge, ties go to the lowest id
+        for (auto it = neighbors.begin(); it != neighbors.end(); ++it) {
+            float currentCost = edgeCollapseCost(v, *it);
 
-        if (currentCost < v->collapseCost) {
-            v->collapseCandidate = (*it).second;
-            v->collapseCost = currentCost;
+            if (currentCost < collapseCost || (currentCost == collapseCost && (int)(*it) < collapseCandidate)) {
+                collapseCandidate = *it;
+                collapseCost = currentCost;
+            }
         }
     }
+
+    // keep the collapse queue ordered with the new cost
+    if (collapseQueue.contains(v)) { collapseQueue.update(v); }
 }
 
-bool  utils::ProgressiveMesh::removeProgFace(std::unordered_map<unsigned int, utils::ProgressiveMesh::Face *>::iterator &it, Vertex *src)
+void utils::ProgressiveMesh::collapse(const unsigned int u, const int v)
 {
-    Face *ptr = (*it).second;
-    bool iteratorInvalidated = false;
+    collapseQueue.remove(u);
+    this->remainingVertices--;
+
+    // a vertex without candidate has no faces or neighbors left
+    if (v == NO_CANDIDATE) { return; }
 
-    // remove association with this face at face vertices
-    for (int i = 0; i < 3; i++) {
-        // if we found this vertice is the src we need to replace
-        // the iterator, erase operation invalidates all class iterators
-        if (!ptr->vertices[i]) { continue; }
+    // v inherits the planes of the removed vertex
+    if (this->costFunction == QuadricErrorMetric) { this->vertexQuadrics[v] += this->vertexQuadrics[u]; }
 
-        auto faceIt  = ptr->vertices[i]->faces.find(ptr->mappingId);
+    IndexList &uFaces = this->vertexFaces[u];
+    this->collapseNeighbors.assign(this->vertexNeighbors[u].begin(), this->vertexNeighbors[u].end());
 
-        if (faceIt == ptr->vertices[i]->faces.end()) { continue; }
+    // deletes the faces sharing the uv edge, erase swaps
+    // the last face into the current slot so i stays
+    for (unsigned int i = 0; i < uFaces.size();) {
+        unsigned int face = uFaces[i];
 
-        if (ptr->vertices[i] && ptr->vertices[i] == src) {
-            it = ptr->vertices[i]->faces.erase(faceIt);
-            iteratorInvalidated = true;
-        } else if (ptr->vertices[i]) {
-            ptr->vertices[i]->faces.erase(faceIt); // else just erase normally
+        if (!faceHasVertex(face, v)) { i++; continue; }
+
+        for (int j = 0; j < 3; j++) {
+            this->vertexFaces[this->faceVertices[face][j]].erase(face);
         }
     }
 
-    // update vertices neighbors
-    for (int i = 0; i < 3; i++) {
-        int j = (i + 1) % 3;
+    // the rest of the u faces now use v
+    for (auto it = uFaces.begin(); it != uFaces.end(); ++it) {
+        std::array<unsigned int, 3> &fv = this->faceVertices[*it];
+        std::replace(fv.begin(), fv.end(), u, (unsigned int)v);
+        this->vertexFaces[v].push(*it, this->adjacencyArena);
+        calculateFaceNormal(*it);
+    }
+
+    uFaces.clear();
+    this->vertexNeighbors[u].clear();
+
+    // only u neighbors (v included) changed their adjacency
+    for (auto it = this->collapseNeighbors.begin(); it != this->collapseNeighbors.end(); ++it) {
+        updateNeighbors(*it);
+    }
+
+    // recalculate edge cost with new neighbors
+    for (auto it = this->collapseNeighbors.begin(); it != this->collapseNeighbors.end(); ++it) {
+        edgeCostAtVertex(*it);
+    }
+
+    // v quadric changed so every edge towards v changed its cost
+    if (this->costFunction == QuadricErrorMetric) {
+        const IndexList &vNeighbors = this->vertexNeighbors[v];
 
-        if (ptr->vertices[i] && ptr->vertices[j]) {
-            ptr->vertices[i]->removeNonNeighbor(ptr->vertices[j]);
-            ptr->vertices[j]->removeNonNeighbor(ptr->vertices[i]);
+        for (auto it = vNeighbors.begin(); it != vNeighbors.end(); ++it) {
+            if (std::find(this->collapseNeighbors.begin(), this->collapseNeighbors.end(), *it) == this->collapseNeighbors.end()) { edgeCostAtVertex(*it); }
         }
     }
+}
 
-    // delete face reserved memory
-    delete ptr;
-    // delete face reference from
-    // progressivemeshes class collection
-    this->progFaces.erase(ptr->mappingId);
-    // return iterator status
-    return iteratorInvalidated;
+unsigned int utils::ProgressiveMesh::minimumCostEdge()
+{
+    // the lowest cost vertex to be deleted meaning
+    // this vertex will affect less the final model
+    return collapseQueue.top();
 }
 
-void utils::ProgressiveMesh::collapse(Vertex *u, Vertex *v)
+void utils::ProgressiveMesh::CollapseQueue::reset(const std::vector<float> *costs)
 {
-    if (!v) {
-        this->progVertices.erase(u->mappingId);
-        delete u;;
-        return;
-    }
+    this->costs = costs;
+    heap.clear();
+    heap.reserve(costs->size());
+    heapIndex.resize(costs->size());
+    std::fill(heapIndex.begin(), heapIndex.end(), (unsigned int)INVALID_INDEX);
+}
+
+void utils::ProgressiveMesh::CollapseQueue::release()
+{
+    std::vector<unsigned int>().swap(heap);
+    std::vector<unsigned int>().swap(heapIndex);
+}
 
-    std::unordered_map<unsigned int, Vertex *> tmpNeighbors = u->neightbors;
-    // deletes the face triangle from the progmesh
-    // and updates vertices and neighbors accordly
-    auto it = u->faces.begin();
+bool utils::ProgressiveMesh::CollapseQueue::lessThan(const unsigned int a, const unsigned int b) const
+{
+    if ((*costs)[a] != (*costs)[b]) { return (*costs)[a] < (*costs)[b]; }
 
-    while (it != u->faces.end()) {
-        if ((*it).second->hasVertex(v)) {
-            removeProgFace(it, u) ? it : ++it;
-        } else { ++it; }
-    }
+    return a < b;
+}
 
-    // update rest of the triangles and vertices
-    // accordily to deleted triangle
-    it = u->faces.begin();
+void utils::ProgressiveMesh::CollapseQueue::place(const unsigned int v, const unsigned int index)
+{
+    heap[index] = v;
+    heapIndex[v] = index;
+}
+
+void utils::ProgressiveMesh::CollapseQueue::siftUp(unsigned int index)
+{
+    unsigned int v = heap[index];
 
-    while (it != u->faces.end()) {
-        (*it).second->replaceVertex(it, u, v) ?  it : ++it;
+    while (index > 0) {
+        unsigned int parent = (index - 1) / 2;
+
+        if (!lessThan(v, heap[parent])) { break; }
+
+        place(heap[parent], index);
+        index = parent;
     }
 
-    this->progVertices.erase(u->mappingId);
-    delete u;
+    place(v, index);
+}
 
-    // recalculate edge cost with new neighbors
-    for (auto it = tmpNeighbors.begin(); it != tmpNeighbors.end(); ++it) {
-        edgeCostAtVertex((*it).second);
+void utils::ProgressiveMesh::CollapseQueue::siftDown(unsigned int index)
+{
+    unsigned int v = heap[index];
+    unsigned int count = heap.size();
+
+    while (true) {
+        unsigned int child = index * 2 + 1;
+
+        if (child >= count) { break; }
+
+        // pick the smallest of both children
+        if (child + 1 < count && lessThan(heap[child + 1], heap[child])) { child++; }
+
+        if (!lessThan(heap[child], v)) { break; }
+
+        place(heap[child], index);
+        index = child;
     }
+
+    place(v, index);
 }
 
-utils::ProgressiveMesh::Vertex *utils::ProgressiveMesh::minimumCostEdge()
+void utils::ProgressiveMesh::CollapseQueue::push(const unsigned int v)
 {
-    Vertex *minCostVertex = (*(progVertices.begin())).second;
-    // the find lowest cost vertex to be deleted meaning
-    // this vertex will affect less the final model
-    auto it = std::find_if(progVertices.begin(), progVertices.end(),
-    [&minCostVertex](const std::pair<unsigned int, Vertex *> &index) {
-        // found smaller cost so swap vertex candidate
-        if (index.second->collapseCost < minCostVertex->collapseCost) {
-            minCostVertex = index.second;
-
-            // early loop break if the collapse cost is zero or really close to zero
-            if (minCostVertex->collapseCost > -glm::epsilon<float>() && minCostVertex->collapseCost < glm::epsilon<float>()) {
-                return true;
-            }
-        }
+    heap.push_back(v);
+    siftUp(heap.size() - 1);
+}
 
-        return false;
-    });
-    return minCostVertex;
+void utils::ProgressiveMesh::CollapseQueue::remove(const unsigned int v)
+{
+    if (!contains(v)) { return; }
+
+    unsigned int index = heapIndex[v];
+    unsigned int last = heap.back();
+    heap.pop_back();
+    heapIndex[v] = INVALID_INDEX;
+
+    if (last == v) { return; }
+
+    // move the last element to the removed place and restore order
+    place(last, index);
+    update(last);
+}
+
+void utils::ProgressiveMesh::CollapseQueue::update(const unsigned int v)
+{
+    unsigned int index = heapIndex[v];
+
+    if (index > 0 && lessThan(v, heap[(index - 1) / 2])) {
+        siftUp(index);
+    } else {
+        siftDown(index);
+    }
 }
 
 void utils::ProgressiveMesh::copyVertices(const std::vector<types::Vertex> &vertices)
 {
-    int index = 0;
+    const unsigned int count = vertices.size();
+    this->vertexPositions.resize(count);
 
-    for (std::vector<types::Vertex>::const_iterator it = vertices.begin(); it < vertices.end(); ++it) {
-        this->progVertices[index++] = new Vertex(index, *it); // starts from 1
+    for (unsigned int i = 0; i < count; i++) {
+        this->vertexPositions[i] = vertices[i].position;
     }
+
+    this->vertexCollapseCost.assign(count, 0.f);
+    this->vertexCollapseCandidate.assign(count, (int)NO_CANDIDATE);
+    this->vertexNeighbors.assign(count, IndexList());
+    this->vertexFaces.assign(count, IndexList());
+    this->remainingVertices = count;
 }
 
 void utils::ProgressiveMesh::copyFaces(const std::vector<types::Face> &faces)
 {
-    int index = 0;
-
-    for (std::vector<types::Face>::const_iterator it = faces.begin(); it < faces.end(); ++it) {
-        this->progFaces[index++] = new Face(index, progVertices[(*it).indices[0]], progVertices[(*it).indices[1]], progVertices[(*it).indices[2]], *it);;
+    const unsigned int count = faces.size();
+    this->faceVertices.resize(count);
+    this->faceNormals.resize(count);
+
+    for (unsigned int face = 0; face < count; face++) {
+        std::array<unsigned int, 3> &fv = this->faceVertices[face];
+        fv = faces[face].indices;
+        calculateFaceNormal(face);
+
+        // associate face vertices with this face and between them as neighbors
+        for (int i = 0; i < 3; i++) {
+            this->vertexFaces[fv[i]].push(face, this->adjacencyArena);
+
+            for (int j = 0; j < 3; j++) {
+                if (fv[i] != fv[j] && !this->vertexNeighbors[fv[i]].contains(fv[j])) {
+                    this->vertexNeighbors[fv[i]].push(fv[j], this->adjacencyArena);
+                }
+            }
+        }
     }
 }
 
+size_t utils::ProgressiveMesh::generationDataBytes() const
+{
+    return this->vertexPositions.capacity() * sizeof(glm::vec3)
+           + this->vertexCollapseCost.capacity() * sizeof(float)
+           + this->vertexCollapseCandidate.capacity() * sizeof(int)
+           + this->vertexNeighbors.capacity() * sizeof(IndexList)
+           + this->vertexFaces.capacity() * sizeof(IndexList)
+           + this->vertexQuadrics.capacity() * sizeof(Quadric)
+           + this->faceVertices.capacity() * sizeof(std::array<unsigned int, 3>)
+           + this->faceNormals.capacity() * sizeof(glm::vec3)
+           // collapse queue heap and heap positions
+           + this->vertexPositions.size() * sizeof(unsigned int) * 2
+           + this->adjacencyArena.reservedBytes();
+}
+
+void utils::ProgressiveMesh::releaseGenerationData()
+{
+    std::vector<glm::vec3>().swap(this->vertexPositions);
+    std::vector<float>().swap(this->vertexCollapseCost);
+    std::vector<int>().swap(this->vertexCollapseCandidate);
+    std::vector<IndexList>().swap(this->vertexNeighbors);
+    std::vector<IndexList>().swap(this->vertexFaces);
+    std::vector<Quadric>().swap(this->vertexQuadrics);
+    std::vector<std::array<unsigned int, 3> >().swap(this->faceVertices);
+    std::vector<glm::vec3>().swap(this->faceNormals);
+    std::vector<unsigned int>().swap(this->collapseNeighbors);
+    this->collapseQueue.release();
+    this->adjacencyArena.release();
+}
+
 void utils::ProgressiveMesh::generateProgressiveMesh(const std::vector<types::Vertex> &vertices, const std::vector<types::Face> &faces)
 {
     vertexCount = vertices.size();
     polyCount = faces.size();
     // copy regular mesh values to prog mesh structures
     copyVertices(vertices); copyFaces(faces);
+
+    if (this->costFunction == QuadricErrorMetric) { computeQuadrics(); }
+
     // allocate space for output
-    this->candidatesMap.resize(this->progVertices.size());
-    this->permutations.resize(this->progVertices.size());
+    this->candidatesMap.resize(vertexCount);
+    this->permutations.resize(vertexCount);
+    this->collapseCosts.resize(vertexCount);
+
+    // empty queue, initial costs don't need to reorder it
+    this->collapseQueue.reset(&this->vertexCollapseCost);
 
-    for (auto it = this->progVertices.begin(); it != this->progVertices.end(); ++it) {
-        edgeCostAtVertex((*it).second);
+    for (unsigned int v = 0; v < vertexCount; v++) {
+        edgeCostAtVertex(v);
     }
 
-    while (!this->progVertices.empty()) {
-        Vertex *mnimum = minimumCostEdge();
+    // order all vertices by their collapse cost
+    for (unsigned int v = 0; v < vertexCount; v++) {
+        this->collapseQueue.push(v);
+    }
+
+    while (this->remainingVertices > 0) {
+        unsigned int mnimum = minimumCostEdge();
+        int candidate = this->vertexCollapseCandidate[mnimum];
         // track of the collapse vertices order
-        this->permutations[mnimum->mappingId] = this->progVertices.size() - 1;
+        this->permutations[mnimum] = this->remainingVertices - 1;
         // track of the collapse candidate
-        this->candidatesMap[this->progVertices.size() - 1] = mnimum->collapseCandidate != nullptr ? mnimum->collapseCandidate->mappingId : -1;
+        this->candidatesMap[this->remainingVertices - 1] = candidate;
+        // removing a vertex without candidate, and so without faces, costs nothing
+        this->collapseCosts[this->remainingVertices - 1] = candidate == NO_CANDIDATE ? 0.0f : this->vertexCollapseCost[mnimum];
         // collapse with candidate and reorganize progressivemesh
-        this->collapse(mnimum, mnimum->collapseCandidate);
+        this->collapse(mnimum, candidate);
     }
 
+    // the arena only grows so the peak is reached at the end
+    this->generationPeakBytes = generationDataBytes();
+    releaseGenerationData();
+
     for (auto it = this->candidatesMap.begin(); it != this->candidatesMap.end(); ++it) {
-        (*it) = (*it) == -1 ? 0 : this->permutations[(*it)];
+        (*it) = (*it) == NO_CANDIDATE ? 0 : this->permutations[(*it)];
     }
 }
 
@@ -324,12 +543,16 @@ void utils::ProgressiveMesh::generateProgressiveMesh(const scene::Mesh::SubMesh
 }
 
 
-utils::ProgressiveMesh::ProgressiveMesh(const std::vector<types::Vertex> &vertices, const std::vector<types::Face> &faces) : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1)
+utils::ProgressiveMesh::ProgressiveMesh(const std::vector<types::Vertex> &vertices, const std::vector<types::Face> &faces,
+        const CollapseCost costFunction /* = MelaxCurvature */) : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1), generationPeakBytes(0), levelPrefixFaces(0),
+    morphTargetsVertexCount(0), morphTargetsBase(0.0f), shadowPrefixFaces(0), shadowVertexCount(0), costFunction(costFunction)
 {
     generateProgressiveMesh(vertices, faces);
 }
 
-utils::ProgressiveMesh::ProgressiveMesh(const scene::Mesh::SubMesh *input) : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1)
+utils::ProgressiveMesh::ProgressiveMesh(const scene::Mesh::SubMesh *input, const CollapseCost costFunction /* = MelaxCurvature */) : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1),
+    generationPeakBytes(0), levelPrefixFaces(0), morphTargetsVertexCount(0), morphTargetsBase(0.0f), shadowPrefixFaces(0), shadowVertexCount(0),
+    costFunction(costFunction)
 {
     generateProgressiveMesh(input);
 }
@@ -350,9 +573,34 @@ void utils::ProgressiveMesh::permuteVertices(std::vector<types::Vertex> &vertice
         for (int j = 0; j < 3; j++) {
             faces[i].indices[j] = permutations[faces[i].indices[j]];
             faces[i].vertices[j] = &vertices[faces[i].indices[j]];
+        }
+    }
+
+    // a face only changes once the level drops below its highest vertex
+    // index, sorted this way lower levels only touch the faces tail
+    std::stable_sort(faces.begin(), faces.end(), [](const types::Face & a, const types::Face & b) {
+        return std::max(std::max(a.indices[0], a.indices[1]), a.indices[2]) < std::max(std::max(b.indices[0], b.indices[1]), b.indices[2]);
+    });
+    this->faceLevels.resize(faces.size());
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        for (int j = 0; j < 3; j++) {
             indices[i * 3 + j] = faces[i].indices[j];
         }
+
+        this->faceLevels[i] = std::max(std::max(faces[i].indices[0], faces[i].indices[1]), faces[i].indices[2]);
     }
+
+    this->buildFaceCounts(faces);
+
+    // full resolution is the starting buffer level
+    this->levelIndices = indices;
+    this->levelPrefixFaces = faces.size();
+    this->morphTargetsVertexCount = 0;
+    // candidates may have changed since the maps were resolved
+    this->levelMap = CollapseMap();
+    this->baseLevelMap = CollapseMap();
+    this->levelData = LevelData();
 }
 
 void utils::ProgressiveMesh::permuteVertices(scene::Mesh::SubMesh *input)
@@ -360,17 +608,39 @@ void utils::ProgressiveMesh::permuteVertices(scene::Mesh::SubMesh *input)
     this->permuteVertices(input->vertices, input->indices, input->faces);
 }
 
-unsigned int utils::ProgressiveMesh::mapVertexCollapse(const unsigned int a, const unsigned int b)
+const std::vector<unsigned int> &utils::ProgressiveMesh::resolveCollapseMap(const unsigned int vertexCount, CollapseMap &out) const
 {
-    if (b <= 0) { return 0; }
+    const unsigned int mapSize = candidatesMap.size();
+
+    if (out.map.size() != mapSize) {
+        out.map.resize(mapSize);
 
-    unsigned int result = a;
+        for (unsigned int i = 0; i < mapSize; i++) { out.map[i] = i; }
 
-    while (result >= b) {
-        result = candidatesMap[result];
+        out.vertexCount = mapSize;
     }
 
-    return result;
+    if (out.vertexCount == vertexCount) { return out.map; }
+
+    if (vertexCount == 0) {
+        std::fill(out.map.begin(), out.map.end(), 0);
+        out.vertexCount = 0;
+        return out.map;
+    }
+
+    // vertices below the count stay in place
+    for (unsigned int i = std::min(out.vertexCount, mapSize); i < std::min(vertexCount, mapSize); i++) {
+        out.map[i] = i;
+    }
+
+    // lower entries are already resolved when a vertex reads its candidate
+    for (unsigned int i = vertexCount; i < mapSize; i++) {
+        const unsigned int candidate = candidatesMap[i];
+        out.map[i] = candidate < vertexCount ? candidate : out.map[candidate];
+    }
+
+    out.vertexCount = vertexCount;
+    return out.map;
 }
 
 utils::ProgressiveMesh::ReducedMesh *utils::ProgressiveMesh::reduceVerticesCount(const std::vector<types::Vertex> &vertices,
@@ -384,10 +654,12 @@ utils::ProgressiveMesh::ReducedMesh *utils::ProgressiveMesh::reduceVerticesCount
     result->vertices.resize(vertexCount);
     types::Vertex permutedVertex[3];
     unsigned int permutePosition[3], permutePositionLoD[3];
+    const std::vector<unsigned int> &collapseMap = this->resolveCollapseMap(vertexCount, this->levelMap);
+    const std::vector<unsigned int> &collapseMapLoD = this->resolveCollapseMap((unsigned int)(vertexCount * levelOfDetailBase), this->baseLevelMap);
 
     for (unsigned int i = 0; i < faces.size(); i++) {
         for (int j = 0; j < 3; j++) {
-            permutePosition[j] = this->mapVertexCollapse(faces[i].indices[j], vertexCount);
+            permutePosition[j] = collapseMap[faces[i].indices[j]];
         }
 
         if (permutePosition[0] == permutePosition[1]
@@ -399,7 +671,7 @@ utils::ProgressiveMesh::ReducedMesh *utils::ProgressiveMesh::reduceVerticesCount
         result->faces.push_back(faces[i]);
 
         for (int j = 0; j < 3; j++) {
-            permutePositionLoD[j] = this->mapVertexCollapse(permutePosition[j], (int)(vertexCount * levelOfDetailBase));
+            permutePositionLoD[j] = collapseMapLoD[permutePosition[j]];
         }
 
         for (int j = 0; j < 3; j++) {
@@ -424,64 +696,996 @@ utils::ProgressiveMesh::ReducedMesh *utils::ProgressiveMesh::reduceVerticesCount
     return reduceVerticesCount(input->vertices, input->indices, input->faces, vertexCount);
 }
 
-void utils::ProgressiveMesh::reduceAndSetBufferData(scene::Mesh::SubMesh *input, const int vertexCount)
+unsigned int utils::ProgressiveMesh::errorVertexCount(const float maxError) const
 {
-    ReducedMesh *rslt = reduceVerticesCount(input->vertices, input->indices, input->faces, vertexCount);
+    unsigned int count = this->collapseCosts.size();
 
-    if (rslt) {
-        input->active = true;
-        input->setBuffersData(rslt->vertices, rslt->indices);
-        delete rslt;
-    } else {
-        input->active = false;
-        input->setBuffersData(std::vector<types::Vertex>(), std::vector<unsigned int>());
-    }
+    // the highest entries collapse first
+    while (count > 0 && this->collapseCosts[count - 1] <= maxError) { count--; }
+
+    return count;
 }
 
-void utils::MeshReductor::load(scene::Mesh *baseMesh)
+unsigned int utils::ProgressiveMesh::polyVertexCount(const unsigned int polyCount) const
 {
-    this->baseMesh = baseMesh;
-    originalPolyCount = originalVertexCount = 0;
-    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    if (this->faceCounts.empty()) { return this->candidatesMap.size(); }
 
-    for (auto it = baseSubmeshes.begin(); it != baseSubmeshes.end(); ++it) {
-        this->reducedMeshEntries.push_back(ProgressiveMesh(*it));
-        this->reducedMeshEntries.back().permuteVertices(*it);
-        originalVertexCount += this->reducedMeshEntries.back().vertexCount;
-        originalPolyCount += this->reducedMeshEntries.back().polyCount;
-        std::cout << "MeshReductor(" << this << ") " << "generated progressive mesh for Submesh(" << *it << ") with polycount (" << this->reducedMeshEntries.back().polyCount << ") ";
-        std::cout << "and vertexcount (" << this->reducedMeshEntries.back().vertexCount << ")" << std::endl;
+    // the faces left only grow with the vertex count
+    return std::upper_bound(this->faceCounts.begin(), this->faceCounts.end(), polyCount) - this->faceCounts.begin() - 1;
+}
+
+unsigned int utils::ProgressiveMesh::prefixFaces(const unsigned int vertexCount) const
+{
+    return std::lower_bound(this->faceLevels.begin(), this->faceLevels.end(), vertexCount) - this->faceLevels.begin();
+}
+
+void utils::ProgressiveMesh::buildFaceCounts(const std::vector<types::Face> &faces)
+{
+    const unsigned int count = this->candidatesMap.size();
+    // each face is gone at or below its entry, faces degenerated from the start never count
+    std::vector<unsigned int> removedAt(faces.size(), 0);
+    std::vector<unsigned int> corners(faces.size() * 3);
+    std::vector<std::vector<unsigned int>> incidentFaces(count);
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        for (int j = 0; j < 3; j++) {
+            corners[i * 3 + j] = faces[i].indices[j];
+        }
+
+        if (corners[i * 3] == corners[i * 3 + 1] || corners[i * 3 + 1] == corners[i * 3 + 2] || corners[i * 3 + 2] == corners[i * 3]) {
+            removedAt[i] = count;
+            continue;
+        }
+
+        for (int j = 0; j < 3; j++) {
+            incidentFaces[corners[i * 3 + j]].push_back(i);
+        }
     }
 
-    this->actualPolyCount = originalPolyCount;
-    this->actualVertexCount = originalVertexCount;
+    // collapse from the last vertex down, a face goes once two of its corners meet
+    for (unsigned int v = count - 1; v > 0 && v < count; v--) {
+        const int candidate = this->candidatesMap[v];
+
+        if (candidate < 0) { continue; }
+
+        for (auto it = incidentFaces[v].begin(); it != incidentFaces[v].end(); ++it) {
+            unsigned int *corner = &corners[(*it) * 3];
+
+            if (removedAt[*it] != 0) { continue; }
+
+            for (int j = 0; j < 3; j++) {
+                corner[j] = corner[j] == v ? (unsigned int)candidate : corner[j];
+            }
+
+            if (corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0]) {
+                removedAt[*it] = v;
+            } else {
+                incidentFaces[candidate].push_back(*it);
+            }
+        }
+
+        std::vector<unsigned int>().swap(incidentFaces[v]);
+    }
+
+    this->faceCounts.assign(count + 1, 0);
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        if (removedAt[i] < count) { this->faceCounts[removedAt[i] + 1]++; }
+    }
+
+    for (unsigned int i = 1; i <= count; i++) {
+        this->faceCounts[i] += this->faceCounts[i - 1];
+    }
 }
 
-void utils::MeshReductor::reduce(const float prcentil /* 0.0 - 1.0 */)
+void utils::ProgressiveMesh::collapsedIndices(const std::vector<types::Face> &faces, const unsigned int vertexCount, const unsigned int firstFace,
+        CollapseMap &map, std::vector<unsigned int> &out) const
 {
-    unsigned int finalVertexCount = (unsigned int)((float)originalVertexCount * prcentil);
-    unsigned int meshIndex; actualPolyCount = meshIndex = actualVertexCount = 0;
-    reduce(finalVertexCount);
+    unsigned int permutePosition[3];
+    const std::vector<unsigned int> &collapseMap = this->resolveCollapseMap(vertexCount, map);
+
+    for (unsigned int i = firstFace; i < faces.size(); i++) {
+        for (int j = 0; j < 3; j++) {
+            permutePosition[j] = collapseMap[faces[i].indices[j]];
+        }
+
+        if (permutePosition[0] == permutePosition[1]
+                || permutePosition[1] == permutePosition[2]
+                || permutePosition[2] == permutePosition[0]) {
+            continue;
+        }
+
+        out.insert(out.end(), permutePosition, permutePosition + 3);
+    }
 }
 
-void utils::MeshReductor::reduce(const unsigned int vertexCount)
+void utils::ProgressiveMesh::bakeLevels(scene::Mesh::SubMesh *input, const std::vector<float> &ratios)
 {
-    unsigned int meshIndex; actualPolyCount = meshIndex = actualVertexCount = 0;
-    unsigned int reductionTotalAcum = 0;
-    unsigned int reductionPerMesh = 0;
-    float percentilReduction = (float)(originalVertexCount - vertexCount) / originalVertexCount;
-    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    BakedLevels levels;
+    this->packLevels(input, ratios, levels);
+    this->setBakedLevels(input, levels);
+}
 
-    for (auto it = this->reducedMeshEntries.begin(); it != this->reducedMeshEntries.end(); ++it, ++meshIndex) {
-        reductionPerMesh = (unsigned int)std::ceil(baseSubmeshes[meshIndex]->vertices.size() * percentilReduction);
+void utils::ProgressiveMesh::packLevels(const scene::Mesh::SubMesh *input, const std::vector<float> &ratios, BakedLevels &out)
+{
+    out = BakedLevels();
+
+    if (input->vertices.empty() || input->faces.empty() || this->faceLevels.size() != input->faces.size()) { return; }
+
+    // the full resolution region stays first, continuous reduction keeps working on it
+    const unsigned int fullCount = input->indices.size();
+
+    for (auto it = ratios.begin(); it != ratios.end(); ++it) {
+        scene::Mesh::SubMesh::IndexRange range;
+        const unsigned int levelVertexCount = std::min((unsigned int)(std::max(0.0f, (*it)) * input->vertices.size()), (unsigned int)input->vertices.size());
+        out.vertexCounts.push_back(levelVertexCount);
 
-        if (reductionTotalAcum <= originalVertexCount - vertexCount) {
-            (*it).reduceAndSetBufferData(baseSubmeshes[meshIndex], baseSubmeshes[meshIndex]->vertices.size() - reductionPerMesh);
+        if (levelVertexCount == input->vertices.size()) {
+            range.offset = 0; range.count = fullCount;
+        } else {
+            range.offset = fullCount + out.indices.size();
+
+            // faces below the level keep their full resolution indices
+            if (levelVertexCount > 2) {
+                const unsigned int prefixFaceCount = this->prefixFaces(levelVertexCount);
+                out.indices.insert(out.indices.end(), input->indices.begin(), input->indices.begin() + prefixFaceCount * 3);
+                this->collapsedIndices(input->faces, levelVertexCount, prefixFaceCount, this->levelMap, out.indices);
+            }
+
+            range.count = fullCount + out.indices.size() - range.offset;
         }
 
-        reductionTotalAcum += reductionPerMesh;
-        actualPolyCount += (*it).polyCount;
-        actualVertexCount += (*it).vertexCount;
+        out.ranges.push_back(range);
+    }
+}
+
+bool utils::ProgressiveMesh::setBakedLevels(scene::Mesh::SubMesh *input, const BakedLevels &levels)
+{
+    input->indexLevels.clear();
+    this->bakedVertexCounts.clear();
+
+    if (input->vertices.empty() || input->faces.empty() || this->faceLevels.size() != input->faces.size()) { return false; }
+
+    const unsigned int fullCount = input->indices.size();
+
+    if (levels.ranges.size() != levels.vertexCounts.size()) { return false; }
+
+    for (unsigned int i = 0; i < levels.ranges.size(); i++) {
+        if (levels.vertexCounts[i] > input->vertices.size() || levels.ranges[i].offset + levels.ranges[i].count > fullCount + levels.indices.size()) { return false; }
+    }
+
+    std::vector<unsigned int> packedIndices = input->indices;
+    packedIndices.insert(packedIndices.end(), levels.indices.begin(), levels.indices.end());
+    this->levelIndices = input->indices;
+    this->levelPrefixFaces = input->faces.size();
+    this->bakedVertexCounts = levels.vertexCounts;
+    input->indexLevels = levels.ranges;
+    // one upload for every level, afterwards switching levels only changes the draw range
+    input->drawComputedLevel = false;
+    input->setIndexBufferSubData(packedIndices, 0);
+    input->indicesCount = fullCount;
+    return true;
+}
+
+void utils::ProgressiveMesh::setLevel(scene::Mesh::SubMesh *input, const unsigned int level)
+{
+    if (level >= input->indexLevels.size() || level >= this->bakedVertexCounts.size()) { return; }
+
+    const scene::Mesh::SubMesh::IndexRange &range = input->indexLevels[level];
+
+    // full resolution region, restores what continuous reduction changed
+    if (range.offset == 0) {
+        this->reduceAndSetBufferData(input, input->vertices.size());
+        return;
+    }
+
+    input->active = range.count > 0;
+    input->drawComputedLevel = false;
+    input->indicesOffset = range.offset;
+    input->indicesCount = range.count;
+
+    if (morphingFactor != 1.0f) { this->updateMorphTargets(input, this->bakedVertexCounts[level]); }
+
+    input->geomorphFactor = 1.0f - morphingFactor;
+    this->vertexCount = this->bakedVertexCounts[level];
+    this->polyCount = range.count / 3;
+}
+
+void utils::ProgressiveMesh::collapsedPositions(const scene::Mesh::SubMesh *input, const unsigned int levelVertexCount, CollapseMap &map,
+        std::vector<glm::vec3> &out) const
+{
+    const std::vector<unsigned int> &collapseMapLoD = this->resolveCollapseMap((unsigned int)(levelVertexCount * levelOfDetailBase), map);
+    out.resize(levelVertexCount);
+
+    for (unsigned int i = 0; i < levelVertexCount; i++) {
+        out[i] = input->vertices[collapseMapLoD[i]].position;
+    }
+}
+
+void utils::ProgressiveMesh::updateMorphTargets(scene::Mesh::SubMesh *input, const unsigned int levelVertexCount,
+        const std::vector<glm::vec3> *targets /* = nullptr */)
+{
+    if (this->morphTargetsVertexCount == levelVertexCount && this->morphTargetsBase == levelOfDetailBase) { return; }
+
+    if (!targets) {
+        this->collapsedPositions(input, levelVertexCount, this->baseLevelMap, this->scratchTargets);
+        targets = &this->scratchTargets;
     }
+
+    input->setMorphTargetsData(*targets);
+    this->morphTargetsVertexCount = levelVertexCount;
+    this->morphTargetsBase = levelOfDetailBase;
 }
 
+void utils::ProgressiveMesh::setMorphingFactor(scene::Mesh::SubMesh *input, const float factor)
+{
+    this->morphingFactor = factor;
+
+    // the drawn level targets are written once, later factors only change the uniform
+    if (morphingFactor != 1.0f && input->indicesCount > 0) { this->updateMorphTargets(input, this->vertexCount); }
+
+    input->geomorphFactor = 1.0f - morphingFactor;
+}
+
+void utils::ProgressiveMesh::reduceAndSetBufferData(scene::Mesh::SubMesh *input, const int vertexCount)
+{
+    this->computeLevel(input, vertexCount, false, this->levelData);
+    this->setLevelData(input, this->levelData);
+}
+
+void utils::ProgressiveMesh::computeLevel(const scene::Mesh::SubMesh *input, const int vertexCount, const bool morphTargets, LevelData &out) const
+{
+    out.vertexCount = out.prefixFaces = 0;
+    out.indices.clear();
+    out.morphTargets.clear();
+
+    if (vertexCount <= 2 || input->vertices.empty() || input->faces.empty() || this->faceLevels.size() != input->faces.size()) { return; }
+
+    out.vertexCount = std::min((unsigned int)vertexCount, (unsigned int)input->vertices.size());
+    out.prefixFaces = this->prefixFaces(out.vertexCount);
+    this->collapsedIndices(input->faces, out.vertexCount, out.prefixFaces, out.levelMap, out.indices);
+
+    if (morphTargets) {
+        this->collapsedPositions(input, out.vertexCount, out.baseLevelMap, out.morphTargets);
+        out.morphTargetsBase = levelOfDetailBase;
+    }
+}
+
+void utils::ProgressiveMesh::setLevelData(scene::Mesh::SubMesh *input, const LevelData &data)
+{
+    if (data.vertexCount <= 2 || this->faceLevels.size() != input->faces.size()) {
+        input->active = false;
+        input->indicesCount = 0;
+        return;
+    }
+
+    // faces below both the previous and the new level keep their indices
+    const unsigned int firstIndex = std::min(this->levelPrefixFaces, data.prefixFaces) * 3;
+    const unsigned int prefixIndex = data.prefixFaces * 3;
+    const unsigned int levelCount = prefixIndex + data.indices.size();
+    auto levelIndex = [&](const unsigned int i) { return i < prefixIndex ? input->indices[i] : data.indices[i - prefixIndex]; };
+    // skip the leading indices that didn't change after all
+    unsigned int changedIndex = firstIndex;
+    const unsigned int previousCount = this->levelIndices.size();
+
+    while (changedIndex < previousCount && changedIndex < levelCount && this->levelIndices[changedIndex] == levelIndex(changedIndex)) {
+        changedIndex++;
+    }
+
+    this->levelIndices.resize(firstIndex);
+    this->levelIndices.insert(this->levelIndices.end(), input->indices.begin() + firstIndex, input->indices.begin() + prefixIndex);
+    this->levelIndices.insert(this->levelIndices.end(), data.indices.begin(), data.indices.end());
+    this->levelPrefixFaces = data.prefixFaces;
+    input->active = true;
+    input->drawComputedLevel = false;
+    input->setIndexBufferSubData(this->levelIndices, changedIndex);
+
+    // coarser level positions for the vertex shader blend, only needed while morphing
+    if (morphingFactor != 1.0f) {
+        const bool computed = data.morphTargets.size() == data.vertexCount && data.morphTargetsBase == levelOfDetailBase;
+        this->updateMorphTargets(input, data.vertexCount, computed ? &data.morphTargets : nullptr);
+    }
+
+    input->geomorphFactor = 1.0f - morphingFactor;
+
+    // rewite statistic data
+    this->vertexCount = data.vertexCount;
+    this->polyCount = this->levelIndices.size() / 3;
+}
+
+void utils::ProgressiveMesh::setShadowLevel(scene::Mesh::SubMesh *input, const unsigned int vertexCount)
+{
+    // the view level is as coarse already
+    if (vertexCount >= this->vertexCount || this->faceLevels.size() != input->faces.size()) {
+        input->drawShadowLevel = false;
+        return;
+    }
+
+    // baked levels only change the draw range, they go from the finest to the
+    // coarsest, the shadow takes the coarsest one at or above vertexCount
+    if (!this->bakedVertexCounts.empty()) {
+        unsigned int level = 0;
+
+        while (level + 1 < this->bakedVertexCounts.size() && this->bakedVertexCounts[level + 1] >= vertexCount) { level++; }
+
+        const scene::Mesh::SubMesh::IndexRange &range = input->indexLevels[level];
+        // the full resolution region holds the view level
+        input->drawShadowLevel = range.offset != 0 && this->bakedVertexCounts[level] < this->vertexCount;
+        input->shadowLevelBuffered = false;
+        input->shadowIndicesOffset = range.offset;
+        input->shadowIndicesCount = range.count;
+        return;
+    }
+
+    // the shadow index buffer still holds it
+    if (vertexCount == this->shadowVertexCount) {
+        input->setShadowIndicesData(this->shadowIndices, this->shadowIndices.size());
+        return;
+    }
+
+    this->computeLevel(input, vertexCount, false, this->shadowLevelData);
+    // faces below both the previous and the new level keep their indices
+    const unsigned int firstIndex = std::min(this->shadowPrefixFaces, this->shadowLevelData.prefixFaces) * 3;
+    const unsigned int prefixIndex = this->shadowLevelData.prefixFaces * 3;
+    this->shadowIndices.resize(firstIndex);
+    this->shadowIndices.insert(this->shadowIndices.end(), input->indices.begin() + firstIndex, input->indices.begin() + prefixIndex);
+    this->shadowIndices.insert(this->shadowIndices.end(), this->shadowLevelData.indices.begin(), this->shadowLevelData.indices.end());
+    this->shadowPrefixFaces = this->shadowLevelData.prefixFaces;
+    this->shadowVertexCount = vertexCount;
+    input->setShadowIndicesData(this->shadowIndices, firstIndex);
+}
+
+void utils::ProgressiveMesh::setFrontIndices(scene::Mesh::SubMesh *input, const std::vector<unsigned int> &indices, const std::vector<scene::Mesh::SubMesh::IndexRange> &ranges,
+        const unsigned int activeVertexCount)
+{
+    // a front is no prefix level, the copy follows it through the patched ranges only
+    this->levelIndices.resize(indices.size());
+
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        std::copy(indices.begin() + (*it).offset, indices.begin() + (*it).offset + (*it).count, this->levelIndices.begin() + (*it).offset);
+    }
+
+    this->levelPrefixFaces = 0;
+    input->active = !indices.empty();
+    input->drawComputedLevel = false;
+    input->setIndexBufferRanges(this->levelIndices, ranges);
+    input->geomorphFactor = 0.0f;
+    // rewite statistic data
+    this->vertexCount = activeVertexCount;
+    this->polyCount = this->levelIndices.size() / 3;
+}
+
+bool utils::ProgressiveMesh::reduceOnGpu(scene::Mesh::SubMesh *input, const int vertexCount)
+{
+    const types::ShaderProgram *program = collections::stored::StoredShaders::getStoredShader(core::StoredShaders::CollapseIndices);
+
+    if (!program || input->vertices.empty() || this->faceLevels.size() != input->faces.size()) { return false; }
+
+    if (vertexCount <= 2) {
+        input->active = false;
+        input->indicesCount = 0;
+        return true;
+    }
+
+    // the shader gathers from the index buffer, cpu levels have to be undone first
+    if (this->levelPrefixFaces != input->faces.size() || this->levelIndices.size() != input->indices.size()) {
+        this->reduceAndSetBufferData(input, input->vertices.size());
+    }
+
+    if (!input->hasCollapseCandidates()) {
+        std::vector<unsigned int> candidates(this->candidatesMap.size());
+
+        for (unsigned int i = 0; i < candidates.size(); i++) {
+            candidates[i] = this->candidatesMap[i] == NO_CANDIDATE ? 0 : this->candidatesMap[i];
+        }
+
+        input->setCollapseCandidatesData(candidates);
+    }
+
+    const unsigned int levelVertexCount = std::min((unsigned int)vertexCount, (unsigned int)input->vertices.size());
+    // the table matches the shader output, the gpu count replaces it once read back
+    this->polyCount = levelVertexCount < this->faceCounts.size() ? this->faceCounts[levelVertexCount] : this->polyCount;
+    input->active = true;
+    input->computeLevelIndices(program, levelVertexCount);
+
+    if (morphingFactor != 1.0f) { this->updateMorphTargets(input, levelVertexCount); }
+
+    input->geomorphFactor = 1.0f - morphingFactor;
+    this->vertexCount = levelVertexCount;
+    return true;
+}
+
+bool utils::ProgressiveMesh::readGpuPolyCount(scene::Mesh::SubMesh *input)
+{
+    unsigned int indexCount = 0;
+
+    if (!input->drawComputedLevel || !input->computedIndicesCount(indexCount)) { return false; }
+
+    this->polyCount = indexCount / 3;
+    return true;
+}
+
+bool utils::ProgressiveMesh::validateGpuLevel(scene::Mesh::SubMesh *input)
+{
+    if (!input->drawComputedLevel) { return true; }
+
+    // same faces as the cpu level in any order, the shader appends them atomically
+    std::vector<unsigned int> gpuIndices, cpuIndices;
+    input->computedIndices(gpuIndices);
+    this->collapsedIndices(input->faces, this->vertexCount, 0, this->levelMap, cpuIndices);
+    auto sortedFaces = [](const std::vector<unsigned int> &indices) {
+        std::vector<std::array<unsigned int, 3>> faces(indices.size() / 3);
+
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            // rotated to start at the lowest vertex, winding kept
+            const unsigned int first = indices[i * 3] <= std::min(indices[i * 3 + 1], indices[i * 3 + 2]) ? 0 : indices[i * 3 + 1] <= indices[i * 3 + 2] ? 1 : 2;
+
+            for (unsigned int j = 0; j < 3; j++) { faces[i][j] = indices[i * 3 + (first + j) % 3]; }
+        }
+
+        std::sort(faces.begin(), faces.end());
+        return faces;
+    };
+
+    if (sortedFaces(gpuIndices) == sortedFaces(cpuIndices)) { return true; }
+
+    std::cout << "ProgressiveMesh(" << this << ") " << "gpu level of " << this->vertexCount << " vertices doesn't match the cpu one, ";
+    std::cout << gpuIndices.size() / 3 << " faces against " << cpuIndices.size() / 3 << std::endl;
+    return false;
+}
+
+utils::MeshReductor::~MeshReductor()
+{
+    this->stopWorker();
+}
+
+void utils::MeshReductor::load(scene::Mesh *baseMesh, const CollapseCost costFunction /* = MelaxCurvature */)
+{
+    // the worker reads the data about to be replaced
+    this->stopWorker();
+    // a proxy from cluster keeps its resolution as part of the cache key
+    this->clusterGridResolution = baseMesh == this->baseMesh ? this->clusterGridResolution : 0;
+    this->baseMesh = baseMesh;
+    originalPolyCount = originalVertexCount = 0;
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    const unsigned int subMeshCount = baseSubmeshes.size();
+    this->reducedMeshEntries.assign(subMeshCount, ProgressiveMesh(costFunction));
+    std::vector<long long> elapsedTimes(subMeshCount, 0);
+    // collapse data from a previous session for this same asset and options
+    this->cacheKey = ProgressiveMeshCache::cacheKey(scene::Mesh::IMPORT_FLAGS, costFunction, this->clusterGridResolution);
+    bool cached = ProgressiveMeshCache::load(baseMesh->getFilepath(), this->cacheKey, baseSubmeshes, this->reducedMeshEntries);
+    if (cached) {
+        std::cout << "MeshReductor(" << this << ") " << "loaded progressive meshes from " << ProgressiveMeshCache::cacheFilename(baseMesh->getFilepath()) << std::endl;
+    } else {
+        // generation only reads the submeshes cpu data, so each worker
+        // takes the next pending submesh until all of them are done
+        std::atomic<unsigned int> nextSubMesh(0);
+        auto generationWorker = [&]() {
+            for (unsigned int i = nextSubMesh++; i < subMeshCount; i = nextSubMesh++) {
+                auto startTime = std::chrono::high_resolution_clock::now();
+                this->reducedMeshEntries[i].generateProgressiveMesh(baseSubmeshes[i]);
+                elapsedTimes[i] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+            }
+        };
+        // the calling thread works too, the rest come from what other threads in flight left
+        const unsigned int spawnedWorkers = core::ExecutionInfo::TakeWorkers(subMeshCount > 1 ? subMeshCount - 1 : 0);
+        std::vector<std::thread> workers;
+
+        for (unsigned int i = 0; i < spawnedWorkers; i++) {
+            workers.push_back(std::thread(generationWorker));
+        }
+
+        generationWorker();
+
+        for (auto it = workers.begin(); it != workers.end(); ++it) {
+            (*it).join();
+        }
+
+        core::ExecutionInfo::ReleaseWorkers(spawnedWorkers);
+
+        ProgressiveMeshCache::save(baseMesh->getFilepath(), this->cacheKey, this->reducedMeshEntries);
+    }
+
+    // submesh data modifications stay on the calling (gl) thread
+    for (unsigned int i = 0; i < subMeshCount; i++) {
+        this->reducedMeshEntries[i].permuteVertices(baseSubmeshes[i]);
+        // permuted full resolution buffers, level changes only rewrite ranges of them
+        baseSubmeshes[i]->setBuffersData();
+        baseSubmeshes[i]->drawShadowLevel = false;
+        originalVertexCount += this->reducedMeshEntries[i].vertexCount;
+        originalPolyCount += this->reducedMeshEntries[i].polyCount;
+        std::cout << "MeshReductor(" << this << ") " << "generated progressive mesh for Submesh(" << baseSubmeshes[i] << ") with polycount (" << this->reducedMeshEntries[i].polyCount << ") ";
+        std::cout << "and vertexcount (" << this->reducedMeshEntries[i].vertexCount << ") in " << elapsedTimes[i] << "ms ";
+        std::cout << "using " << this->reducedMeshEntries[i].generationPeakBytes / 1024 << "KB" << std::endl;
+    }
+
+    this->actualPolyCount = originalPolyCount;
+    this->actualVertexCount = originalVertexCount;
+    this->requestedVertexCount = originalVertexCount;
+    this->viewRefinements.clear();
+    this->shadowRequestedVertexCount = 0;
+    this->shadowVertexCounts.clear();
+}
+
+bool utils::MeshReductor::exportStream(const std::string &sFilename) const
+{
+    if (!this->baseMesh || this->reducedMeshEntries.empty()) { return false; }
+
+    // the submeshes keep their permuted full resolution indices whatever level is drawn
+    bool saved = ProgressiveMeshStream::save(sFilename, this->baseMesh->getMeshEntries(), this->reducedMeshEntries);
+
+    if (saved) { std::cout << "MeshReductor(" << this << ") " << "exported progressive stream " << sFilename << std::endl; }
+
+    return saved;
+}
+
+void utils::MeshReductor::cluster(scene::Mesh *baseMesh, const unsigned int gridResolution)
+{
+    // the current progressive meshes belong to the geometry about to be replaced
+    this->stopWorker();
+    this->reducedMeshEntries.clear();
+    this->viewRefinements.clear();
+    this->levelCount = 0;
+    this->baseMesh = baseMesh;
+    this->clusterGridResolution = gridResolution;
+    originalPolyCount = originalVertexCount = 0;
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    VertexClustering clustering(gridResolution);
+    std::vector<types::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<types::Face> faces;
+
+    // clustering spreads each submesh over the cores by itself
+    for (auto it = baseSubmeshes.begin(); it != baseSubmeshes.end(); ++it) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        unsigned int inputPolyCount = (*it)->faces.size();
+        clustering.simplify((*it)->vertices, (*it)->indices, vertices, indices, faces);
+        // swapped together, faces point into the proxy vertices
+        (*it)->vertices.swap(vertices);
+        (*it)->indices.swap(indices);
+        (*it)->faces.swap(faces);
+        (*it)->indexLevels.clear();
+        (*it)->geomorphFactor = 0.0f;
+        (*it)->active = !(*it)->indices.empty();
+        (*it)->drawShadowLevel = false;
+        (*it)->setBuffersData();
+        originalVertexCount += (*it)->vertices.size();
+        originalPolyCount += (*it)->faces.size();
+        std::cout << "MeshReductor(" << this << ") " << "clustered Submesh(" << (*it) << ") from polycount (" << inputPolyCount << ") to (" << (*it)->faces.size() << ") ";
+        std::cout << "in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count() << "ms" << std::endl;
+    }
+
+    // the input geometry memory goes away with the swap buffers
+    std::vector<types::Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    std::vector<types::Face>().swap(faces);
+    this->actualPolyCount = originalPolyCount;
+    this->actualVertexCount = originalVertexCount;
+    this->requestedVertexCount = originalVertexCount;
+}
+
+void utils::MeshReductor::reduce(const float prcentil /* 0.0 - 1.0 */)
+{
+    unsigned int finalVertexCount = (unsigned int)((float)originalVertexCount * prcentil);
+    unsigned int meshIndex; actualPolyCount = meshIndex = actualVertexCount = 0;
+    reduce(finalVertexCount);
+}
+
+void utils::MeshReductor::reduce(const unsigned int vertexCount)
+{
+    // clustered only, there is no progressive mesh to reduce
+    if (this->reducedMeshEntries.empty()) { return; }
+
+    this->distributeVertexCount(vertexCount, this->frontVertexCounts);
+    this->reduceSubMeshes(vertexCount);
+}
+
+void utils::MeshReductor::reduceSubMeshes(const unsigned int vertexCount)
+{
+    unsigned int meshIndex; actualPolyCount = meshIndex = actualVertexCount = 0;
+    this->discardPendingReduction();
+    this->requestedVertexCount = vertexCount;
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+
+    for (auto it = this->reducedMeshEntries.begin(); it != this->reducedMeshEntries.end(); ++it, ++meshIndex) {
+        const int levelVertexCount = this->frontVertexCounts[meshIndex];
+
+        // the cpu path also takes over if the gpu one isn't available
+        if (levelVertexCount >= 0 && !(this->computeLevels && (*it).reduceOnGpu(baseSubmeshes[meshIndex], levelVertexCount))) {
+            (*it).reduceAndSetBufferData(baseSubmeshes[meshIndex], levelVertexCount);
+        }
+
+        actualPolyCount += (*it).polyCount;
+        actualVertexCount += (*it).vertexCount;
+    }
+}
+
+void utils::MeshReductor::distributeVertexCount(const unsigned int vertexCount, std::vector<int> &out) const
+{
+    unsigned int reductionTotalAcum = 0;
+    unsigned int reductionPerMesh = 0;
+    float percentilReduction = (float)(originalVertexCount - vertexCount) / originalVertexCount;
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    out.resize(this->reducedMeshEntries.size());
+
+    for (unsigned int i = 0; i < out.size(); i++) {
+        reductionPerMesh = (unsigned int)std::ceil(baseSubmeshes[i]->vertices.size() * percentilReduction);
+        out[i] = reductionTotalAcum <= originalVertexCount - vertexCount ? (int)(baseSubmeshes[i]->vertices.size() - reductionPerMesh) : -1;
+        reductionTotalAcum += reductionPerMesh;
+    }
+}
+
+void utils::MeshReductor::requestReduce(const float prcentil /* 0.0 - 1.0 */)
+{
+    requestReduce((unsigned int)((float)originalVertexCount * prcentil));
+}
+
+void utils::MeshReductor::requestReduce(const unsigned int vertexCount)
+{
+    if (this->reducedMeshEntries.empty()) { return; }
+
+    // the gpu builds the level without a cpu pass to move off the thread
+    if (this->computeLevels) {
+        reduce(vertexCount);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->workerMutex);
+        this->queuedVertexCount = vertexCount;
+        this->queuedMorphing = this->reducedMeshEntries[0].morphingFactor != 1.0f;
+        this->requestQueued = true;
+    }
+
+    if (!this->worker.joinable()) {
+        this->workerExit = false;
+        this->worker = std::thread(&MeshReductor::reductionWorker, this);
+    }
+
+    this->workerCondition.notify_one();
+}
+
+void utils::MeshReductor::reductionWorker()
+{
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    std::unique_lock<std::mutex> lock(this->workerMutex);
+
+    while (true) {
+        this->workerCondition.wait(lock, [this]() { return this->workerExit || this->requestQueued; });
+
+        if (this->workerExit) { return; }
+
+        // only the latest request counts, a finished result not yet applied is stale too
+        const unsigned int vertexCount = this->queuedVertexCount;
+        const bool morphing = this->queuedMorphing;
+        const unsigned int discards = this->discardCount;
+        this->requestQueued = false;
+        this->backReady = false;
+        lock.unlock();
+        // the back buffers belong to the worker until backReady is set
+        this->distributeVertexCount(vertexCount, this->backVertexCounts);
+        this->backLevels.resize(this->reducedMeshEntries.size());
+
+        for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+            if (this->backVertexCounts[i] < 0) { continue; }
+
+            this->reducedMeshEntries[i].computeLevel(baseSubmeshes[i], this->backVertexCounts[i], morphing, this->backLevels[i]);
+        }
+
+        lock.lock();
+
+        if (discards == this->discardCount) {
+            this->backVertexCount = vertexCount;
+            this->backReady = true;
+        }
+    }
+}
+
+void utils::MeshReductor::applyPendingReduction()
+{
+    // gpu levels finished since the last frame report their real face counts
+    if (this->computeLevels && !this->reducedMeshEntries.empty()) {
+        const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+        bool updated = false;
+
+        for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+            if (!this->reducedMeshEntries[i].readGpuPolyCount(baseSubmeshes[i])) { continue; }
+
+            if (this->validateComputeLevels) { this->reducedMeshEntries[i].validateGpuLevel(baseSubmeshes[i]); }
+
+            updated = true;
+        }
+
+        if (updated) {
+            actualPolyCount = 0;
+
+            for (auto it = this->reducedMeshEntries.begin(); it != this->reducedMeshEntries.end(); ++it) { actualPolyCount += (*it).polyCount; }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->workerMutex);
+
+        if (!this->backReady) { return; }
+
+        this->frontLevels.swap(this->backLevels);
+        this->frontVertexCounts.swap(this->backVertexCounts);
+        this->requestedVertexCount = this->backVertexCount;
+        this->backReady = false;
+    }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    actualPolyCount = actualVertexCount = 0;
+
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        if (this->frontVertexCounts[i] >= 0) {
+            this->reducedMeshEntries[i].setLevelData(baseSubmeshes[i], this->frontLevels[i]);
+        }
+
+        actualPolyCount += this->reducedMeshEntries[i].polyCount;
+        actualVertexCount += this->reducedMeshEntries[i].vertexCount;
+    }
+}
+
+void utils::MeshReductor::discardPendingReduction()
+{
+    std::lock_guard<std::mutex> lock(this->workerMutex);
+    this->requestQueued = false;
+    this->backReady = false;
+    this->discardCount++;
+}
+
+void utils::MeshReductor::stopWorker()
+{
+    if (!this->worker.joinable()) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(this->workerMutex);
+        this->workerExit = true;
+        this->requestQueued = false;
+        this->backReady = false;
+    }
+
+    this->workerCondition.notify_one();
+    this->worker.join();
+}
+
+void utils::MeshReductor::bakeLevels(const std::vector<float> &ratios)
+{
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    this->discardPendingReduction();
+    std::vector<ProgressiveMesh::BakedLevels> levels;
+    bool cached = ProgressiveMeshCache::loadLevels(baseMesh->getFilepath(), this->cacheKey, ratios, baseSubmeshes, levels);
+
+    for (unsigned int i = 0; cached && i < this->reducedMeshEntries.size(); i++) {
+        cached = this->reducedMeshEntries[i].setBakedLevels(baseSubmeshes[i], levels[i]);
+    }
+
+    if (cached) {
+        std::cout << "MeshReductor(" << this << ") " << "loaded baked levels from " << ProgressiveMeshCache::levelsFilename(baseMesh->getFilepath()) << std::endl;
+    } else {
+        levels.resize(this->reducedMeshEntries.size());
+
+        for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+            this->reducedMeshEntries[i].packLevels(baseSubmeshes[i], ratios, levels[i]);
+            this->reducedMeshEntries[i].setBakedLevels(baseSubmeshes[i], levels[i]);
+        }
+
+        ProgressiveMeshCache::saveLevels(baseMesh->getFilepath(), this->cacheKey, ratios, baseSubmeshes, levels);
+    }
+
+    // baking resets every submesh to full resolution
+    this->levelCount = ratios.size();
+    this->actualPolyCount = originalPolyCount;
+    this->actualVertexCount = originalVertexCount;
+    this->requestedVertexCount = originalVertexCount;
+}
+
+void utils::MeshReductor::bakeLevels(const unsigned int levelCount)
+{
+    std::vector<float> ratios(levelCount);
+
+    for (unsigned int i = 0; i < levelCount; i++) {
+        ratios[i] = 1.0f / (float)(1 << i);
+    }
+
+    bakeLevels(ratios);
+}
+
+void utils::MeshReductor::setLevel(const unsigned int level)
+{
+    if (level >= this->levelCount) { return; }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    actualPolyCount = actualVertexCount = 0;
+    this->discardPendingReduction();
+
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        this->reducedMeshEntries[i].setLevel(baseSubmeshes[i], level);
+        actualPolyCount += this->reducedMeshEntries[i].polyCount;
+        actualVertexCount += this->reducedMeshEntries[i].vertexCount;
+    }
+
+    this->requestedVertexCount = actualVertexCount;
+}
+
+void utils::MeshReductor::setMorphingFactor(const float factor)
+{
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        this->reducedMeshEntries[i].setMorphingFactor(baseSubmeshes[i], factor);
+    }
+}
+
+void utils::MeshReductor::reducePolyCount(const unsigned int polyCount)
+{
+    if (originalPolyCount == 0 || this->reducedMeshEntries.empty()) { return; }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    const unsigned int targetPolyCount = std::min(polyCount, originalPolyCount);
+    unsigned int assignedPolyCount = 0, vertexCount = 0;
+    this->frontVertexCounts.resize(this->reducedMeshEntries.size());
+
+    // the vertex to faces relation isn't linear, each submesh inverts its own table
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        unsigned int subMeshPolyCount = (unsigned int)((double)targetPolyCount * baseSubmeshes[i]->faces.size() / originalPolyCount);
+        // rounding leftovers go to the last submesh
+        subMeshPolyCount = i + 1 == this->reducedMeshEntries.size() ? targetPolyCount - assignedPolyCount : subMeshPolyCount;
+        assignedPolyCount += subMeshPolyCount;
+        this->frontVertexCounts[i] = (int)this->reducedMeshEntries[i].polyVertexCount(subMeshPolyCount);
+        vertexCount += this->frontVertexCounts[i];
+    }
+
+    this->reduceSubMeshes(vertexCount);
+}
+
+void utils::MeshReductor::reduceToError(const float maxError)
+{
+    if (this->reducedMeshEntries.empty()) { return; }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    actualPolyCount = actualVertexCount = 0;
+    this->discardPendingReduction();
+
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        // a bound on the error shouldn't make a submesh vanish, at least a face stays
+        unsigned int vertexCount = std::max(this->reducedMeshEntries[i].errorVertexCount(maxError), 3u);
+
+        if (!(this->computeLevels && this->reducedMeshEntries[i].reduceOnGpu(baseSubmeshes[i], vertexCount))) {
+            this->reducedMeshEntries[i].reduceAndSetBufferData(baseSubmeshes[i], vertexCount);
+        }
+
+        actualPolyCount += this->reducedMeshEntries[i].polyCount;
+        actualVertexCount += this->reducedMeshEntries[i].vertexCount;
+    }
+
+    this->requestedVertexCount = actualVertexCount;
+}
+
+void utils::MeshReductor::reduceByScreenSize(const float screenRadius)
+{
+    if (originalVertexCount == 0) { return; }
+
+    // covered screen area decides the vertex count
+    float coverage = glm::pi<float>() * screenRadius * screenRadius / pixelsPerVertex;
+    unsigned int targetVertexCount = coverage >= (float)originalVertexCount ? originalVertexCount : (unsigned int)coverage;
+
+    if (targetVertexCount == requestedVertexCount) { return; }
+
+    // stay on the current level while the target is inside the band around it
+    if (std::abs((float)targetVertexCount - (float)requestedVertexCount) <= levelHysteresis * (float)requestedVertexCount) { return; }
+
+    reduce(targetVertexCount);
+}
+
+void utils::MeshReductor::reduceShadowCasters()
+{
+    const float casterRadius = this->shadowCasterRadius;
+    this->shadowCasterRadius = 0.0f;
+
+    if (this->reducedMeshEntries.empty() || originalVertexCount == 0) { return; }
+
+    // no shadow pass drew the mesh, the level stays until one does
+    if (this->shadowReduction && casterRadius > 0.0f) {
+        // covered shadow map area decides the vertex count
+        float coverage = glm::pi<float>() * casterRadius * casterRadius / shadowTexelsPerVertex;
+        unsigned int targetVertexCount = coverage >= (float)originalVertexCount ? originalVertexCount : (unsigned int)coverage;
+
+        // tiny casters keep a few vertices
+        if (targetVertexCount < SHADOW_MIN_VERTEX_COUNT) { targetVertexCount = originalVertexCount < SHADOW_MIN_VERTEX_COUNT ? originalVertexCount : SHADOW_MIN_VERTEX_COUNT; }
+
+        // stay on the current level while the target is inside the band around it
+        if (std::abs((float)targetVertexCount - (float)shadowRequestedVertexCount) > levelHysteresis * (float)shadowRequestedVertexCount) {
+            this->shadowRequestedVertexCount = targetVertexCount;
+            this->distributeVertexCount(targetVertexCount, this->shadowVertexCounts);
+        }
+    }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+
+    // the view level may have changed since, so every submesh checks its level again
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        if (!this->shadowReduction || i >= this->shadowVertexCounts.size() || this->shadowVertexCounts[i] < 0) {
+            baseSubmeshes[i]->drawShadowLevel = false;
+            continue;
+        }
+
+        this->reducedMeshEntries[i].setShadowLevel(baseSubmeshes[i], this->shadowVertexCounts[i]);
+    }
+}
+
+void utils::MeshReductor::setShadowReduction(const bool enable)
+{
+    this->shadowReduction = enable;
+    // the next shadow pass radius picks the level again
+    this->shadowRequestedVertexCount = 0;
+    this->shadowVertexCounts.clear();
+}
+
+void utils::MeshReductor::setViewDependent(const bool enable)
+{
+    if (enable == this->isViewDependent() || this->reducedMeshEntries.empty()) { return; }
+
+    if (!enable) {
+        this->viewRefinements.clear();
+        reduce(originalVertexCount);
+        return;
+    }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    // fronts own the index buffers from now on
+    this->discardPendingReduction();
+    this->viewRefinements.resize(this->reducedMeshEntries.size());
+
+    for (unsigned int i = 0; i < this->reducedMeshEntries.size(); i++) {
+        this->viewRefinements[i].setPixelError(pixelError);
+        this->viewRefinements[i].load(this->reducedMeshEntries[i].candidatesMap, baseSubmeshes[i]);
+    }
+}
+
+void utils::MeshReductor::setPixelError(const float val)
+{
+    this->pixelError = val;
+
+    for (auto it = this->viewRefinements.begin(); it != this->viewRefinements.end(); ++it) {
+        (*it).setPixelError(val);
+    }
+}
+
+void utils::MeshReductor::refineForView(const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective)
+{
+    if (this->viewRefinements.empty()) { return; }
+
+    const std::vector<scene::Mesh::SubMesh *> &baseSubmeshes = baseMesh->getMeshEntries();
+    actualPolyCount = actualVertexCount = 0;
+
+    for (unsigned int i = 0; i < this->viewRefinements.size(); i++) {
+        // the update already patched the front indices, only those ranges are uploaded
+        this->viewRefinements[i].update(viewPoint, pixelsPerUnit, perspective);
+
+        if (this->viewRefinements[i].hasDirtyRanges()) {
+            this->viewRefinements[i].takeDirtyRanges(this->frontRanges);
+            this->reducedMeshEntries[i].setFrontIndices(baseSubmeshes[i], this->viewRefinements[i].getIndices(), this->frontRanges, this->viewRefinements[i].getActiveCount());
+        }
+
+        actualPolyCount += this->reducedMeshEntries[i].polyCount;
+        actualVertexCount += this->reducedMeshEntries[i].vertexCount;
+    }
+
+    this->requestedVertexCount = actualVertexCount;
+}
+
+bool utils::MeshReductor::setComputeLevels(const bool enable)
+{
+    if (enable && !collections::stored::StoredShaders::getStoredShader(core::StoredShaders::CollapseIndices)) { return false; }
+
+    if (enable == this->computeLevels) { return true; }
+
+    this->computeLevels = enable;
+
+    // redo the current level on the selected path
+    if (!this->reducedMeshEntries.empty()) { reduce(this->requestedVertexCount); }
+
+    return true;
+}
@@ -2,89 +2,252 @@
 #include "..\types\Vertex.h"
 #include "..\types\Face.h"
 #include "..\Scene\Mesh.h"
-#include <unordered_map>
-#include <map>
-#include <set>
+#include "VertexClustering.h"
+#include "ViewDependentRefinement.h"
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace utils {
 
+    // edge collapse cost functions available for progressive mesh generation
+    enum CollapseCost : unsigned int {
+        // Melax edge length times curvature heuristic
+        MelaxCurvature,
+        // Garland-Heckbert quadric error metric
+        QuadricErrorMetric,
+    };
+
     class ProgressiveMesh {
+        public:
+
+            // collapse target of every vertex for a given vertex count
+            struct CollapseMap {
+                std::vector<unsigned int> map;
+                unsigned int vertexCount;
+                CollapseMap() : vertexCount(0) {};
+            };
+            // cpu side of a level change, computeLevel only reads the progressive
+            // mesh data and the meshEntry geometry so it can run on another thread
+            struct LevelData {
+                unsigned int vertexCount;
+                // faces before it keep their full resolution indices
+                unsigned int prefixFaces;
+                // surviving indices of the faces after the prefix
+                std::vector<unsigned int> indices;
+                // levelOfDetailBase positions, empty if not requested
+                std::vector<glm::vec3> morphTargets;
+                float morphTargetsBase;
+                CollapseMap levelMap;
+                CollapseMap baseLevelMap;
+                LevelData() : vertexCount(0), prefixFaces(0), morphTargetsBase(0.0f) {};
+            };
+            // discrete levels packed after the full resolution indices, see bakeLevels
+            struct BakedLevels {
+                std::vector<unsigned int> vertexCounts;
+                std::vector<scene::Mesh::SubMesh::IndexRange> ranges;
+                // every level indices, the full resolution ones aren't included
+                std::vector<unsigned int> indices;
+            };
+
         private:
 
-            class Face;
-            class Vertex;
+            // symmetric 4x4 error quadric, only the upper triangle is stored
+            class Quadric {
+                public:
+                    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+                    Quadric();
+                    // quadric for the plane n.p + d = 0 scaled by weight
+                    Quadric(const glm::vec3 &n, const double d, const double weight);
+                    Quadric &operator+=(const Quadric &q);
+                    // squared distance sum of point p to the accumulated planes
+                    double evaluate(const glm::vec3 &p) const;
+            };
 
-            class Face : public types::Face {
+            // bump allocator for the adjacency lists that outgrow their inline
+            // storage, all of its memory is released at once after generation
+            class IndexArena {
                 public:
-                    // instances new face and associate vertex neighbors and vertex's faces with this instance
-                    Face(const unsigned int id, Vertex *v1, Vertex *v2, Vertex *v3, const types::Face &nonProgFace);
-                    ~Face();
-
-                    std::array <Vertex *, 3> vertices;
-                    unsigned int mappingId;
-                    // returns true on old vertex faces erase
-                    // meaning previous iterators are invalid
-                    bool replaceVertex(std::unordered_map<unsigned int, utils::ProgressiveMesh::Face *>::iterator &it, Vertex *oldVertex, Vertex *newVertex, const bool calcNormal = true);
-                    void calculateNormal();
-                    bool hasVertex(types::Vertex *v);
+                    IndexArena() : current(nullptr), chunkUsed(CHUNK_SIZE) {};
+
+                    unsigned int *allocate(const unsigned int count);
+                    void release();
+                    size_t reservedBytes() const;
+                private:
+                    static const unsigned int CHUNK_SIZE = 1 << 16;
+                    std::vector<std::vector<unsigned int> > chunks;
+                    unsigned int *current;
+                    unsigned int chunkUsed;
+            };
+
+            // unordered list of vertex or face ids, keeps the usual valences
+            // inline and moves to arena memory when it grows beyond that
+            class IndexList {
+                public:
+                    static const unsigned int INLINE_CAPACITY = 8;
+
+                    IndexList() : count(0), capacity(INLINE_CAPACITY), overflow(nullptr) {};
+
+                    unsigned int size() const { return count; }
+                    bool empty() const { return count == 0; }
+                    const unsigned int *begin() const { return overflow ? overflow : items; }
+                    const unsigned int *end() const { return begin() + count; }
+                    unsigned int operator[](const unsigned int index) const { return begin()[index]; }
+                    bool contains(const unsigned int value) const;
+                    void push(const unsigned int value, IndexArena &arena);
+                    // swaps the value with the last element and pops it
+                    void erase(const unsigned int value);
+                    void clear() { count = 0; }
+                private:
+                    unsigned int count;
+                    unsigned int capacity;
+                    unsigned int *overflow;
+                    unsigned int items[INLINE_CAPACITY];
             };
 
-            class Vertex : public types::Vertex {
+            // indexed binary min-heap of vertex ids ordered by collapse cost, it
+            // tracks every vertex heap position so cost changes are O(log n)
+            class CollapseQueue {
                 public:
-                    // instances new vertex
-                    Vertex(const unsigned int id, const types::Vertex &nonProgVert);
-                    // deletes vertex and neighbor associations with this vertex
-                    ~Vertex();
-
-                    unsigned int mappingId;
-                    unsigned int originalPlace;
-                    float collapseCost;
-                    Vertex *collapseCandidate;
-                    std::unordered_map<unsigned int, Vertex * > neightbors;
-                    std::unordered_map<unsigned int, Face * > faces;
-                    void removeNonNeighbor(Vertex *v);
+                    static const unsigned int INVALID_INDEX = (unsigned int) -1;
+
+                    // costs holds the collapse cost of every vertex id
+                    void reset(const std::vector<float> *costs);
+                    bool empty() const { return heap.empty(); }
+                    // returns the vertex with the minimum collapse cost
+                    unsigned int top() const { return heap.front(); }
+                    void push(const unsigned int v);
+                    void remove(const unsigned int v);
+                    // restores heap order after v collapse cost changed
+                    void update(const unsigned int v);
+                    bool contains(const unsigned int v) const { return heapIndex[v] != INVALID_INDEX; }
+                    void release();
+                private:
+                    const std::vector<float> *costs = nullptr;
+                    std::vector<unsigned int> heap;
+                    std::vector<unsigned int> heapIndex;
+                    // orders by cost, ties are solved by the lowest vertex id
+                    bool lessThan(const unsigned int a, const unsigned int b) const;
+                    void siftUp(unsigned int index);
+                    void siftDown(unsigned int index);
+                    void place(const unsigned int v, const unsigned int index);
             };
-            // class specific collections of vertices and faces
-            std::map<unsigned int, Vertex * > progVertices;
-            std::map<unsigned int, Face * > progFaces;
 
+            static const int NO_CANDIDATE = -1;
+            // flat generation data indexed by vertex and face id, faces are
+            // only reachable through vertexFaces so removed faces need no flag
+            std::vector<glm::vec3> vertexPositions;
+            std::vector<float> vertexCollapseCost;
+            std::vector<int> vertexCollapseCandidate;
+            std::vector<IndexList> vertexNeighbors;
+            std::vector<IndexList> vertexFaces;
+            // accumulated planes quadrics, QuadricErrorMetric only
+            std::vector<Quadric> vertexQuadrics;
+            std::vector<std::array<unsigned int, 3> > faceVertices;
+            std::vector<glm::vec3> faceNormals;
+            IndexArena adjacencyArena;
+            CollapseQueue collapseQueue;
+            unsigned int remainingVertices;
+            // reused neighbors copy for collapse()
+            std::vector<unsigned int> collapseNeighbors;
+
+            CollapseCost costFunction;
             // calculates edge collapse cost between
-            // two vertices
-            float edgeCollapseCost(Vertex *u, Vertex *v);
+            // two vertices with the active cost function
+            float edgeCollapseCost(const unsigned int u, const unsigned int v);
+            // melax curvature collapse cost between u and v
+            float curvatureCollapseCost(const unsigned int u, const unsigned int v);
+            // quadric error of moving u into v position
+            float quadricCollapseCost(const unsigned int u, const unsigned int v);
+            // accumulates every face plane quadric into its vertices, border
+            // edges get an extra perpendicular plane to preserve silhouettes
+            void computeQuadrics();
             // calculates minimum collapse cost between
             // all neighbors
-            void edgeCostAtVertex(Vertex *v);
+            void edgeCostAtVertex(const unsigned int v);
             // updates u and v neighbors and faces after
-            // collapsing the uv edge
-            void collapse(Vertex *u, Vertex *v);
-            // iterates through all the class vertices returns
-            // the one with the minimumn collapse cost
-            Vertex *minimumCostEdge();
+            // collapsing the uv edge, v can be NO_CANDIDATE
+            void collapse(const unsigned int u, const int v);
+            // returns the vertex with the minimum collapse cost
+            // from the collapse queue
+            unsigned int minimumCostEdge();
+            // face normal from the current face vertices positions
+            void calculateFaceNormal(const unsigned int face);
+            bool faceHasVertex(const unsigned int face, const unsigned int v) const;
+            // rebuilds v neighbors from the vertices of its faces
+            void updateNeighbors(const unsigned int v);
             // stores normal mesh values into progressive mesh data
             void copyVertices(const std::vector<types::Vertex> &vertices);
             // stores normal mesh values into progressive mesh data
             void copyFaces(const std::vector<types::Face> &faces);
-            // deletes a face at iterator <it>, also deletes its vertices
-            // and neighbors references to this face returns true if the
-            // iterator was invalidated during erase, in which case <it>
-            // becomes the <it> next to the deleted element (valid), used
-            // in collapse() function
-            bool removeProgFace(std::unordered_map<unsigned int, utils::ProgressiveMesh::Face * >::iterator &it, Vertex *src);
-            // maps vertex correctly with collpase order
-            unsigned int mapVertexCollapse(const unsigned int a, const unsigned int b);
+            // bytes held by the generation data structures
+            size_t generationDataBytes() const;
+            // frees all the generation data, only the output stays
+            void releaseGenerationData();
+
+            // highest vertex index of each face, permuteVertices sorts faces by it so
+            // the faces that survive untouched at a level are always a prefix
+            std::vector<unsigned int> faceLevels;
+            // indices currently in the submesh index buffer and the untouched faces prefix
+            std::vector<unsigned int> levelIndices;
+            unsigned int levelPrefixFaces;
+            // level and base the submesh morph targets were written for
+            unsigned int morphTargetsVertexCount;
+            float morphTargetsBase;
+            // vertex count of every baked level
+            std::vector<unsigned int> bakedVertexCounts;
+            // indices currently in the submesh shadow index buffer, its untouched faces
+            // prefix and the level they were computed for, see setShadowLevel
+            std::vector<unsigned int> shadowIndices;
+            unsigned int shadowPrefixFaces;
+            unsigned int shadowVertexCount;
+            LevelData shadowLevelData;
+            // reused between reduceAndSetBufferData calls
+            LevelData levelData;
+            std::vector<glm::vec3> scratchTargets;
+            // resolved maps for reduceVerticesCount, bakeLevels and the morph targets
+            CollapseMap levelMap;
+            CollapseMap baseLevelMap;
+            // resolves where every vertex ends up collapsed down to vertexCount in
+            // a single pass, candidates always have a lower index than their vertex
+            const std::vector<unsigned int> &resolveCollapseMap(const unsigned int vertexCount, CollapseMap &out) const;
+            // number of faces whose vertices are all below vertexCount
+            unsigned int prefixFaces(const unsigned int vertexCount) const;
+            // faces left at every vertex count, from 0 to the full count
+            std::vector<unsigned int> faceCounts;
+            // replays the collapse order over the permuted faces to fill faceCounts
+            void buildFaceCounts(const std::vector<types::Face> &faces);
+            // appends the indices of the faces from firstFace onwards that
+            // survive collapsing the mesh down to vertexCount
+            void collapsedIndices(const std::vector<types::Face> &faces, const unsigned int vertexCount, const unsigned int firstFace, CollapseMap &map,
+                                  std::vector<unsigned int> &out) const;
+            // levelOfDetailBase collapse position of every vertex below levelVertexCount
+            void collapsedPositions(const scene::Mesh::SubMesh *input, const unsigned int levelVertexCount, CollapseMap &map, std::vector<glm::vec3> &out) const;
+            // writes the levelOfDetailBase collapse positions for levelVertexCount as the
+            // meshEntry morph targets, if not already there, computes them if not given
+            void updateMorphTargets(scene::Mesh::SubMesh *input, const unsigned int levelVertexCount, const std::vector<glm::vec3> *targets = nullptr);
 
         public:
 
-            ProgressiveMesh() : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1) {};
-            ProgressiveMesh(const std::vector<types::Vertex> &vertices, const std::vector<types::Face> &faces);
-            ProgressiveMesh(const scene::Mesh::SubMesh *input);
+            ProgressiveMesh(const CollapseCost costFunction = MelaxCurvature) : levelOfDetailBase(0.5f), morphingFactor(1.0f), vertexCount(-1), generationPeakBytes(0), levelPrefixFaces(0),
+                morphTargetsVertexCount(0), morphTargetsBase(0.0f), shadowPrefixFaces(0), shadowVertexCount(0), costFunction(costFunction) {};
+            ProgressiveMesh(const std::vector<types::Vertex> &vertices, const std::vector<types::Face> &faces, const CollapseCost costFunction = MelaxCurvature);
+            ProgressiveMesh(const scene::Mesh::SubMesh *input, const CollapseCost costFunction = MelaxCurvature);
 
             float morphingFactor;
             float levelOfDetailBase;
             unsigned int vertexCount;
             unsigned int polyCount;
+            // peak bytes used by the last generateProgressiveMesh call
+            size_t generationPeakBytes;
             std::vector<int> candidatesMap;
             std::vector<int> permutations;
+            // cost of the collapse that removed each candidatesMap entry, in the cost
+            // function units, Melax edge length times curvature and quadric area
+            // weighted squared distance, not monotonic along the collapse order
+            std::vector<float> collapseCosts;
 
             // generates progmeshes data structures (permutations and candidatesMap)
             // based on a initial mesh model and progressive collapse iterations
@@ -93,7 +256,8 @@ namespace utils {
             void generateProgressiveMesh(const scene::Mesh::SubMesh *input);
             // reorder vertices indices and faces input based on permutation
             // order for future prog meshes iteration generateProgressiveMesh()
-            // had to be called before calling this function
+            // had to be called before calling this function, faces end up sorted
+            // by their highest vertex index
             void permuteVertices(std::vector<types::Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<types::Face> &faces);
             // reorder vertices indices and faces on the meshEntry
             void permuteVertices(scene::Mesh::SubMesh *input);
@@ -108,25 +272,154 @@ namespace utils {
             // indices and faces need to be reorder previously by permuteVertices, final output is the simplified mesh data
             ReducedMesh *reduceVerticesCount(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<types::Face> &faces, const int vertexCount);
             ReducedMesh *reduceVerticesCount(const scene::Mesh::SubMesh *input, const int vertexCount);
+            // fewest vertices reachable collapsing in order until the first collapse costlier than maxError
+            unsigned int errorVertexCount(const float maxError) const;
+            // most vertices whose level keeps at most polyCount faces, inverts faceCounts
+            unsigned int polyVertexCount(const unsigned int polyCount) const;
             // sets buffer data of mesh entry based on reduced mesh, effectively reducing
             // level of detail and modifies indicesCount in input meshEntry, meshEntry vertices
-            // indices and faces need to be reorder previously by permuteVertices(), MeshEntry
-            // input keeps the original vertices indices and faces, function just changes the
-            // indices and vertices buffer object data with the respective reduced mesh result
+            // indices and faces need to be reorder previously by permuteVertices() and its
+            // buffers uploaded at full resolution, only the index range that differs from the
+            // previous level is rewritten, while morphing the level morph targets are written
+            // once and the vertex shader blends towards them by the meshEntry geomorphFactor
             void reduceAndSetBufferData(scene::Mesh::SubMesh *input, const int vertexCount);
+            // packs a discrete level per vertex count ratio after the full resolution indices
+            // in the meshEntry index buffer, with a single upload, and fills its indexLevels
+            // ranges, permuteVertices() has to be called before
+            void bakeLevels(scene::Mesh::SubMesh *input, const std::vector<float> &ratios);
+            // computes the levels bakeLevels packs without touching the meshEntry buffers
+            void packLevels(const scene::Mesh::SubMesh *input, const std::vector<float> &ratios, BakedLevels &out);
+            // uploads levels from packLevels, or a cache of them, and fills the meshEntry
+            // indexLevels, false if they don't belong to the meshEntry
+            bool setBakedLevels(scene::Mesh::SubMesh *input, const BakedLevels &levels);
+            // draws a baked level changing only the meshEntry draw range
+            void setLevel(scene::Mesh::SubMesh *input, const unsigned int level);
+            // sets morphingFactor for the drawn level, the meshEntry morph targets are
+            // only written if the level changed since, otherwise just the draw uniform
+            void setMorphingFactor(scene::Mesh::SubMesh *input, const float factor);
+            // computes the indices for vertexCount and optionally its morph targets
+            // without touching the meshEntry or this level state, thread safe
+            void computeLevel(const scene::Mesh::SubMesh *input, const int vertexCount, const bool morphTargets, LevelData &out) const;
+            // uploads a level from computeLevel to the meshEntry buffers, only the index
+            // range that differs from the current level is rewritten, gl thread only
+            void setLevelData(scene::Mesh::SubMesh *input, const LevelData &data);
+            // shadow caster level for vertexCount, drawn by the shadow pass independently of
+            // the view level, a baked level if there are any, otherwise the indices go to the
+            // meshEntry shadow index buffer, only the range that differs is rewritten, the
+            // view level is drawn instead if it isn't finer, gl thread only
+            void setShadowLevel(scene::Mesh::SubMesh *input, const unsigned int vertexCount);
+            // uploads the indices of a view dependent front, only the given ranges that
+            // the front patched are rewritten, no morphing between fronts
+            void setFrontIndices(scene::Mesh::SubMesh *input, const std::vector<unsigned int> &indices, const std::vector<scene::Mesh::SubMesh::IndexRange> &ranges,
+                                 const unsigned int activeVertexCount);
+            // gpu path of reduceAndSetBufferData, uploads candidatesMap on the first call and
+            // a compute shader gathers the level indices and its draw count from the full
+            // resolution index buffer, polyCount comes from faceCounts until the gpu count
+            // is read, false if compute shaders aren't available, gl thread only
+            bool reduceOnGpu(scene::Mesh::SubMesh *input, const int vertexCount);
+            // takes polyCount from the last gpu level once it finished, never waits for it,
+            // true if updated
+            bool readGpuPolyCount(scene::Mesh::SubMesh *input);
+            // reads the whole gpu level back and compares its faces with the cpu level, it
+            // stalls until the gpu is done, validation only, false and logged if they differ
+            bool validateGpuLevel(scene::Mesh::SubMesh *input);
     };
 
     class MeshReductor {
 
         public:
-            MeshReductor() : loaded(false) {};
-            ~MeshReductor() {};
+            MeshReductor() : baseMesh(nullptr), clusterGridResolution(0), cacheKey(0), loaded(false), automaticReduction(false), pixelsPerVertex(8.0f), levelHysteresis(0.1f), requestedVertexCount(0),
+                screenCoverage(0.0f), budgetPolyCount(0), levelCount(0), pixelError(1.0f), computeLevels(false), validateComputeLevels(false), workerExit(false), requestQueued(false), queuedVertexCount(0), queuedMorphing(false),
+                backReady(false), backVertexCount(0), discardCount(0), shadowReduction(true), shadowTexelsPerVertex(16.0f), shadowCasterRadius(0.0f), shadowRequestedVertexCount(0) {};
+            ~MeshReductor();
 
-            void load(scene::Mesh *baseMesh);
+            void load(scene::Mesh *baseMesh, const CollapseCost costFunction = MelaxCurvature);
+            // replaces every submesh geometry with its vertex clustering proxy, gridResolution cells
+            // along the longest side, in linear time over every core, the proxy is drawn as it is
+            // and a later load of the same mesh generates the progressive meshes over the proxy
+            void cluster(scene::Mesh *baseMesh, const unsigned int gridResolution);
+            // writes the loaded mesh as a progressive stream, see ProgressiveMeshStream, so
+            // a later session can draw it before the whole file arrives
+            bool exportStream(const std::string &sFilename) const;
             /* 0.0 - 1.0 */
             void reduce(const float prcentil);
             // provide final vertex count
             void reduce(const unsigned int vertexCount);
+            // queues the reduction to a worker thread and returns right away, requests
+            // not yet started are replaced by newer ones, the result is uploaded by
+            // the next applyPendingReduction call
+            void requestReduce(const float prcentil);
+            void requestReduce(const unsigned int vertexCount);
+            // uploads the last reduction finished by the worker, if any, gl thread only,
+            // the camera calls it for every mesh at the start of the frame
+            void applyPendingReduction();
+            // bakes a discrete level per vertex count ratio on every submesh, the levels are
+            // read from the asset levels sidecar if it was baked before with these ratios
+            void bakeLevels(const std::vector<float> &ratios);
+            // bakes levelCount levels halving the vertex count each level
+            void bakeLevels(const unsigned int levelCount);
+            // draws a baked level, only the submeshes draw ranges change
+            void setLevel(const unsigned int level);
+            unsigned int getLevelCount() const { return levelCount; }
+            // blend factor towards the levelOfDetailBase positions, 1.0 = no morphing,
+            // runs on the vertex shader so animating it costs no uploads
+            void setMorphingFactor(const float factor);
+            // every submesh collapses until its first collapse costlier than maxError,
+            // in the cost function units, so each one reduces as far as it can
+            void reduceToError(const float maxError);
+            // final poly count, split between the submeshes by their face counts and each
+            // share turned into the vertex count whose level keeps at most those faces
+            void reducePolyCount(const unsigned int polyCount);
+            // picks the vertex count from the mesh bounding sphere projected radius in
+            // pixels, the level only changes once the target leaves the hysteresis band
+            void reduceByScreenSize(const float screenRadius);
+            // view dependent mode, every submesh refines its own collapse hierarchy for the
+            // view point instead of reducing uniformly, disabling it restores full resolution
+            void setViewDependent(const bool enable);
+            bool isViewDependent() const { return !viewRefinements.empty(); }
+            // updates every submesh active front for viewPoint, in the mesh model space, and
+            // uploads the fronts that changed, pixelsPerUnit as in ViewDependentRefinement
+            void refineForView(const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective);
+            // level indices are generated by a compute shader from now on, false if compute
+            // shaders aren't available, disabling it goes back to the cpu path
+            bool setComputeLevels(const bool enable);
+            bool isComputeLevels() const { return computeLevels; }
+            // every finished gpu level is read back and checked against the cpu one, stalls
+            // the frame, off by default
+            void setValidateComputeLevels(const bool enable) { validateComputeLevels = enable; }
+            bool isValidateComputeLevels() const { return validateComputeLevels; }
+            // screen error in pixels allowed for view dependent folding
+            void setPixelError(const float val);
+            float getPixelError() const { return pixelError; }
+
+            // automatic mode, the camera sets the level each frame with reduceByScreenSize
+            void setAutomaticReduction(const bool enable) { automaticReduction = enable; }
+            bool isAutomaticReduction() const { return automaticReduction; }
+            // screen pixels covered per vertex at the automatic level
+            void setPixelsPerVertex(const float val) { pixelsPerVertex = val; }
+            float getPixelsPerVertex() const { return pixelsPerVertex; }
+            // relative vertex count change needed to switch automatic level
+            void setLevelHysteresis(const float val) { levelHysteresis = val; }
+            float getLevelHysteresis() const { return levelHysteresis; }
+            // viewport pixels covered by the mesh, updated by the camera each frame
+            void setScreenCoverage(const float val) { screenCoverage = val; }
+            float getScreenCoverage() const { return screenCoverage; }
+            // shadow passes report the mesh bounding sphere radius in shadow map texels, the
+            // largest since the last reduceShadowCasters call decides the shadow level
+            void addShadowCasterRadius(const float texelRadius) { shadowCasterRadius = texelRadius > shadowCasterRadius ? texelRadius : shadowCasterRadius; }
+            // picks the level shadow passes draw, independent of the view level but never
+            // finer than it, gl thread only, the camera calls it for every mesh at the start
+            // of the frame so the level lags the reported radius by a frame
+            void reduceShadowCasters();
+            // shadow passes draw the view level while disabled
+            void setShadowReduction(const bool enable);
+            bool isShadowReduction() const { return shadowReduction; }
+            // shadow map texels covered per vertex at the shadow level
+            void setShadowTexelsPerVertex(const float val) { shadowTexelsPerVertex = val; }
+            float getShadowTexelsPerVertex() const { return shadowTexelsPerVertex; }
+            // faces assigned to this mesh by the frame triangle budget, 0 if unassigned
+            void setBudgetPolyCount(const unsigned int val) { budgetPolyCount = val; }
+            unsigned int getBudgetPolyCount() const { return budgetPolyCount; }
 
             unsigned int getActualPolyCount() const { return actualPolyCount; }
             unsigned int getActualVertexCount() const { return actualVertexCount; }
@@ -143,8 +436,60 @@ namespace utils {
             unsigned int actualPolyCount;
 
             bool loaded;
+            bool automaticReduction;
+            float pixelsPerVertex;
+            float levelHysteresis;
+            // last level asked through reduce, hysteresis center
+            unsigned int requestedVertexCount;
+            float screenCoverage;
+            unsigned int budgetPolyCount;
+            // baked discrete levels
+            unsigned int levelCount;
             scene::Mesh *baseMesh;
+            // grid resolution of the proxy baseMesh holds, 0 if not clustered
+            unsigned int clusterGridResolution;
+            // sidecar files key of the loaded progressive meshes, 0 if the asset can't be read
+            unsigned long long cacheKey;
             std::vector<ProgressiveMesh> reducedMeshEntries;
+            // view dependent fronts per submesh, empty unless enabled
+            std::vector<ViewDependentRefinement> viewRefinements;
+            std::vector<scene::Mesh::SubMesh::IndexRange> frontRanges;
+            float pixelError;
+            bool computeLevels;
+            bool validateComputeLevels;
+            // vertex count per submesh for a total, -1 keeps the submesh current level
+            void distributeVertexCount(const unsigned int vertexCount, std::vector<int> &out) const;
+            // reduces every submesh to its frontVertexCounts entry
+            void reduceSubMeshes(const unsigned int vertexCount);
+
+            // background reduction, the worker computes into the back buffers
+            // and applyPendingReduction swaps them with the front ones
+            std::thread worker;
+            std::mutex workerMutex;
+            std::condition_variable workerCondition;
+            bool workerExit;
+            bool requestQueued;
+            unsigned int queuedVertexCount;
+            bool queuedMorphing;
+            bool backReady;
+            unsigned int backVertexCount;
+            // bumped by synchronous level changes, results requested before are dropped
+            unsigned int discardCount;
+            std::vector<int> backVertexCounts;
+            std::vector<int> frontVertexCounts;
+            std::vector<ProgressiveMesh::LevelData> backLevels;
+            std::vector<ProgressiveMesh::LevelData> frontLevels;
+            void reductionWorker();
+            void stopWorker();
+            void discardPendingReduction();
+
+            // shadow caster levels, vertex count per submesh, -1 draws the view level
+            static const unsigned int SHADOW_MIN_VERTEX_COUNT = 16;
+            bool shadowReduction;
+            float shadowTexelsPerVertex;
+            float shadowCasterRadius;
+            unsigned int shadowRequestedVertexCount;
+            std::vector<int> shadowVertexCounts;
     };
 }
 
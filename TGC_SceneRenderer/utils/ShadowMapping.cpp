@@ -1,5 +1,6 @@
 #include "ShadowMapping.h"
 #include "..\collections\MeshesCollection.h"
+#include "ProgressiveMeshes.h"
 
 using namespace utils;
 
@@ -111,15 +112,20 @@ void utils::ShadowMapping::shadowRenderPass()
 
     // render all meshes with disabled textures and only position vertex atrib, we only need these for the depth value
     for (unsigned int i = 0; i < meshes->meshCount(); i++) {
+        scene::Mesh *mesh = meshes->getMesh(i);
         // set model view matrix per mesh
-        this->matrices->setModelMatrix(meshes->getMesh(i)->base->transform.getModelMatrix());
+        this->matrices->setModelMatrix(mesh->base->transform.getModelMatrix());
         // recalculate matrices with current loaded matrices
         this->matrices->calculateMatrices();
         // update matrices uniform block data
         this->matrices->setUniformBlock();
-        // finally call glDraw with mesh data, only use position vertex atrib and disable shaders
+
+        // the mesh size on the shadow map picks its shadow level for the next frame
+        if (mesh->isMeshReductionEnabled()) { mesh->getMeshReductor()->addShadowCasterRadius(this->lightPov->projectedRadius(mesh)); }
+
+        // finally call glDraw with mesh data, only the positions of its shadow level
         // we don't need the rest because we are only querying depth info
-        meshes->getMesh(i)->render(true, false, false, false, false, false);
+        mesh->renderShadowCaster();
     }
 
     // disable shader program
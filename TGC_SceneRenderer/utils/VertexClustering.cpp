@@ -0,0 +1,282 @@
+#include "VertexClustering.h"
+#include "..\core\Data.h"
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <unordered_set>
+using namespace utils;
+
+// output triangle in cell ordinals
+typedef std::array<unsigned int, 3> CellTriangle;
+
+struct CellTriangleHash {
+    size_t operator()(const CellTriangle &triangle) const
+    {
+        unsigned long long hash = triangle[0];
+        hash = hash * 0x9e3779b97f4a7c15ULL ^ triangle[1];
+        hash = hash * 0x9e3779b97f4a7c15ULL ^ triangle[2];
+        return (size_t)(hash ^ (hash >> 32));
+    }
+};
+
+typedef std::unordered_set<CellTriangle, CellTriangleHash> CellTriangleSet;
+
+// fewest triangles worth a thread of their own
+static const unsigned int MIN_THREAD_TRIANGLES = 1 << 14;
+// pull towards the corners mean relative to the quadric trace, keeps
+// the flat and crease cells solvable and their point inside the cell
+static const double MEAN_REGULARIZATION = 1e-3;
+
+utils::VertexClustering::Cell::Cell() : corners(0), index(0)
+{
+    std::fill(q, q + 10, 0.0);
+    std::fill(position, position + 3, 0.0);
+    attributes.position = attributes.normal = attributes.tangent = attributes.bitangent = glm::vec3(0.0f);
+    attributes.texCoords = glm::vec2(0.0f);
+}
+
+void utils::VertexClustering::Cell::add(const Cell &cell)
+{
+    for (int i = 0; i < 10; i++) { q[i] += cell.q[i]; }
+
+    for (int i = 0; i < 3; i++) { position[i] += cell.position[i]; }
+
+    attributes.texCoords += cell.attributes.texCoords;
+    attributes.normal += cell.attributes.normal;
+    attributes.tangent += cell.attributes.tangent;
+    attributes.bitangent += cell.attributes.bitangent;
+    corners += cell.corners;
+}
+
+unsigned long long utils::VertexClustering::Grid::key(const glm::vec3 &p) const
+{
+    unsigned long long cell[3];
+
+    for (int i = 0; i < 3; i++) {
+        float offset = (p[i] - origin[i]) / cellSize;
+        cell[i] = offset <= 0.0f ? 0 : std::min((unsigned long long)offset, (unsigned long long)cells[i] - 1);
+    }
+
+    return cell[0] + cells[0] * (cell[1] + (unsigned long long)cells[1] * cell[2]);
+}
+
+void utils::VertexClustering::accumulateCells(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, const Grid &grid,
+        const unsigned int first, const unsigned int last, CellMap &out) const
+{
+    for (unsigned int t = first; t < last; t++) {
+        const types::Vertex *corner[3] = { &vertices[indices[t * 3]], &vertices[indices[t * 3 + 1]], &vertices[indices[t * 3 + 2]] };
+        unsigned long long keys[3] = { grid.key(corner[0]->position), grid.key(corner[1]->position), grid.key(corner[2]->position) };
+        glm::vec3 cross = glm::cross(corner[1]->position - corner[0]->position, corner[2]->position - corner[0]->position);
+        float crossLength = glm::length(cross);
+        // area weighted plane of the face
+        double plane[4] = { 0.0, 0.0, 0.0, 0.0 }, weight = crossLength * 0.5;
+
+        if (crossLength > 0.0f) {
+            glm::vec3 n = cross / crossLength;
+            plane[0] = n.x; plane[1] = n.y; plane[2] = n.z;
+            plane[3] = -glm::dot(n, corner[0]->position);
+        }
+
+        for (int j = 0; j < 3; j++) {
+            Cell &cell = out[keys[j]];
+            const types::Vertex &v = *corner[j];
+            cell.position[0] += v.position.x; cell.position[1] += v.position.y; cell.position[2] += v.position.z;
+            cell.attributes.texCoords += v.texCoords;
+            cell.attributes.normal += v.normal;
+            cell.attributes.tangent += v.tangent;
+            cell.attributes.bitangent += v.bitangent;
+            cell.corners++;
+
+            // the face plane goes once into each cell it touches
+            if (crossLength == 0.0f || (j > 0 && keys[j] == keys[0]) || (j > 1 && keys[j] == keys[1])) { continue; }
+
+            int k = 0;
+
+            for (int r = 0; r < 4; r++) {
+                for (int c = r; c < 4; c++) { cell.q[k++] += weight * plane[r] * plane[c]; }
+            }
+        }
+    }
+}
+
+glm::vec3 utils::VertexClustering::representative(const Cell &cell, const Grid &grid, const unsigned long long key) const
+{
+    const double *q = cell.q;
+    double mean[3] = { cell.position[0] / cell.corners, cell.position[1] / cell.corners, cell.position[2] / cell.corners };
+    double lambda = MEAN_REGULARIZATION * (q[0] + q[4] + q[7]) / 3.0;
+    lambda = lambda > 0.0 ? lambda : 1.0;
+    // (A + lambda I) x = -b + lambda mean
+    double a[3][3] = {
+        { q[0] + lambda, q[1], q[2] },
+        { q[1], q[4] + lambda, q[5] },
+        { q[2], q[5], q[7] + lambda }
+    };
+    double b[3] = { -q[3] + lambda * mean[0], -q[6] + lambda * mean[1], -q[8] + lambda * mean[2] };
+    double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+                 - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+                 + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    glm::vec3 result((float)mean[0], (float)mean[1], (float)mean[2]);
+
+    if (det != 0.0) {
+        // cramer's rule, replacing each column by b
+        double x[3];
+
+        for (int c = 0; c < 3; c++) {
+            double m[3][3];
+
+            for (int r = 0; r < 3; r++) {
+                for (int k = 0; k < 3; k++) { m[r][k] = k == c ? b[r] : a[r][k]; }
+            }
+
+            x[c] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                    - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                    + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+        }
+
+        result = glm::vec3((float)x[0], (float)x[1], (float)x[2]);
+    }
+
+    // the point stays in its cell so the error is bounded by the cell size
+    unsigned long long position[3] = { key % grid.cells[0], (key / grid.cells[0]) % grid.cells[1], key / grid.cells[0] / grid.cells[1] };
+
+    for (int i = 0; i < 3; i++) {
+        float cellMin = grid.origin[i] + position[i] * grid.cellSize;
+        result[i] = glm::clamp(result[i], cellMin, cellMin + grid.cellSize);
+    }
+
+    return result;
+}
+
+void utils::VertexClustering::simplify(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, std::vector<types::Vertex> &outVertices,
+                                       std::vector<unsigned int> &outIndices, std::vector<types::Face> &outFaces) const
+{
+    outVertices.clear(); outIndices.clear(); outFaces.clear();
+
+    if (vertices.empty() || indices.size() < 3 || gridResolution == 0) { return; }
+
+    Grid grid;
+    glm::vec3 minPos = vertices[0].position, maxPos = vertices[0].position;
+
+    for (auto it = vertices.begin(); it != vertices.end(); ++it) {
+        minPos = glm::min(minPos, (*it).position);
+        maxPos = glm::max(maxPos, (*it).position);
+    }
+
+    glm::vec3 extent = maxPos - minPos;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    grid.origin = minPos;
+    grid.cellSize = longest > 0.0f ? longest / gridResolution : 1.0f;
+
+    for (int i = 0; i < 3; i++) {
+        grid.cells[i] = std::max(1u, std::min(gridResolution, (unsigned int)std::ceil(extent[i] / grid.cellSize)));
+    }
+
+    // each thread accumulates its own triangles range into its own cells
+    const unsigned int triangleCount = indices.size() / 3;
+    const unsigned int threadCount = std::max(1u, std::min(core::ExecutionInfo::AVAILABLE_CPU_CORES, triangleCount / MIN_THREAD_TRIANGLES));
+    auto rangeStart = [&](const unsigned int thread) { return (unsigned int)((unsigned long long)triangleCount * thread / threadCount); };
+    std::vector<CellMap> threadCells(threadCount);
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 1; i < threadCount; i++) {
+        workers.push_back(std::thread(&VertexClustering::accumulateCells, this, std::cref(vertices), std::cref(indices), std::cref(grid),
+                                      rangeStart(i), rangeStart(i + 1), std::ref(threadCells[i])));
+    }
+
+    this->accumulateCells(vertices, indices, grid, rangeStart(0), rangeStart(1), threadCells[0]);
+
+    for (auto it = workers.begin(); it != workers.end(); ++it) { (*it).join(); }
+
+    workers.clear();
+    CellMap &cells = threadCells[0];
+
+    for (unsigned int i = 1; i < threadCount; i++) {
+        for (auto it = threadCells[i].begin(); it != threadCells[i].end(); ++it) { cells[it->first].add(it->second); }
+
+        CellMap().swap(threadCells[i]);
+    }
+
+    // cells ordered by key, the output doesn't depend on the thread count
+    std::vector<unsigned long long> keys;
+    keys.reserve(cells.size());
+
+    for (auto it = cells.begin(); it != cells.end(); ++it) { keys.push_back(it->first); }
+
+    std::sort(keys.begin(), keys.end());
+
+    for (unsigned int i = 0; i < keys.size(); i++) { cells[keys[i]].index = i; }
+
+    // triangles spanning three cells, several input triangles usually end up as the same
+    // output one so each thread only keeps the first of each, in input order
+    std::vector<CellTriangleSet> threadSeen(threadCount);
+    std::vector<std::vector<CellTriangle> > threadTriangles(threadCount);
+    auto collectTriangles = [&](const unsigned int thread) {
+        for (unsigned int t = rangeStart(thread); t < rangeStart(thread + 1); t++) {
+            unsigned long long k[3] = { grid.key(vertices[indices[t * 3]].position), grid.key(vertices[indices[t * 3 + 1]].position), grid.key(vertices[indices[t * 3 + 2]].position) };
+
+            if (k[0] == k[1] || k[1] == k[2] || k[2] == k[0]) { continue; }
+
+            CellTriangle triangle = { cells.find(k[0])->second.index, cells.find(k[1])->second.index, cells.find(k[2])->second.index };
+            // same winding starting at the lowest ordinal, duplicates compare equal
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+
+            if (threadSeen[thread].insert(triangle).second) { threadTriangles[thread].push_back(triangle); }
+        }
+    };
+
+    for (unsigned int i = 1; i < threadCount; i++) { workers.push_back(std::thread(collectTriangles, i)); }
+
+    collectTriangles(0);
+
+    for (auto it = workers.begin(); it != workers.end(); ++it) { (*it).join(); }
+
+    // merged in thread order, the first occurrence stays whatever the thread count
+    CellTriangleSet &seen = threadSeen[0];
+    std::vector<CellTriangle> &triangles = threadTriangles[0];
+
+    for (unsigned int i = 1; i < threadCount; i++) {
+        for (auto it = threadTriangles[i].begin(); it != threadTriangles[i].end(); ++it) {
+            if (seen.insert(*it).second) { triangles.push_back(*it); }
+        }
+
+        CellTriangleSet().swap(threadSeen[i]);
+        std::vector<CellTriangle>().swap(threadTriangles[i]);
+    }
+
+    CellTriangleSet().swap(seen);
+
+    // only the cells some triangle uses become vertices
+    const unsigned int unused = (unsigned int) -1;
+    std::vector<unsigned int> vertexIndex(keys.size(), unused);
+
+    for (unsigned int i = 0; i < triangles.size(); i++) {
+        for (int j = 0; j < 3; j++) {
+            unsigned int &index = vertexIndex[triangles[i][j]];
+
+            if (index == unused) {
+                index = outVertices.size();
+                const Cell &cell = cells[keys[triangles[i][j]]];
+                types::Vertex v = cell.attributes;
+                v.position = this->representative(cell, grid, keys[triangles[i][j]]);
+                v.texCoords /= (float)cell.corners;
+                v.normal = glm::length(v.normal) > 0.0f ? glm::normalize(v.normal) : v.normal;
+                v.tangent = glm::length(v.tangent) > 0.0f ? glm::normalize(v.tangent) : v.tangent;
+                v.bitangent = glm::length(v.bitangent) > 0.0f ? glm::normalize(v.bitangent) : v.bitangent;
+
+                if (glm::length(v.tangent) > 0.0f) { v.orthogonalize(); }
+
+                outVertices.push_back(v);
+            }
+
+            outIndices.push_back(index);
+        }
+    }
+
+    // faces point into outVertices, it doesn't grow anymore
+    outFaces.reserve(outIndices.size() / 3);
+
+    for (unsigned int i = 0; i < outIndices.size(); i += 3) {
+        outFaces.push_back(types::Face(outVertices[outIndices[i]], outVertices[outIndices[i + 1]], outVertices[outIndices[i + 2]],
+                                       outIndices[i], outIndices[i + 1], outIndices[i + 2]));
+    }
+}
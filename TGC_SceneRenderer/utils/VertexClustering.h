@@ -0,0 +1,59 @@
+#pragma once
+#include "..\types\Vertex.h"
+#include "..\types\Face.h"
+#include <unordered_map>
+#include <vector>
+
+namespace utils {
+
+    // out of core style vertex clustering, a uniform grid over the input bounds merges every
+    // vertex in a cell into the point minimizing the cell faces quadric, only the triangles
+    // spanning three cells stay. one pass over the triangles builds the cells and another one
+    // the output, memory grows with the occupied cells instead of the input, each pass splits
+    // the triangles among the available cores
+    class VertexClustering {
+        public:
+            VertexClustering(const unsigned int gridResolution = 128) : gridResolution(gridResolution) {};
+
+            // simplifies the indexed triangles, outFaces point to outVertices elements so
+            // both have to be moved or swapped together
+            void simplify(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, std::vector<types::Vertex> &outVertices,
+                          std::vector<unsigned int> &outIndices, std::vector<types::Face> &outFaces) const;
+
+            // cells along the longest side of the input bounds
+            void setGridResolution(const unsigned int val) { gridResolution = val; }
+            unsigned int getGridResolution() const { return gridResolution; }
+
+        private:
+
+            // accumulated face planes and corner attributes of a grid cell
+            struct Cell {
+                // symmetric 4x4 quadric, upper triangle
+                double q[10];
+                double position[3];
+                types::Vertex attributes;
+                unsigned int corners;
+                // output vertex id
+                unsigned int index;
+                Cell();
+                void add(const Cell &cell);
+            };
+
+            typedef std::unordered_map<unsigned long long, Cell> CellMap;
+
+            unsigned int gridResolution;
+            // grid placement for the current input
+            struct Grid {
+                glm::vec3 origin;
+                float cellSize;
+                unsigned int cells[3];
+                unsigned long long key(const glm::vec3 &p) const;
+            };
+
+            // adds the triangles [first, last) planes and corners to their cells
+            void accumulateCells(const std::vector<types::Vertex> &vertices, const std::vector<unsigned int> &indices, const Grid &grid,
+                                 const unsigned int first, const unsigned int last, CellMap &out) const;
+            // point minimizing the cell quadric, the cell corners mean if it's singular
+            glm::vec3 representative(const Cell &cell, const Grid &grid, const unsigned long long key) const;
+    };
+}
@@ -0,0 +1,322 @@
+#include "ViewDependentRefinement.h"
+#include "glm\gtc\constants.hpp"
+#include <algorithm>
+#include <chrono>
+using namespace utils;
+
+// allowed pixel error scale where the subtree normals cone crosses the view
+// direction, silhouettes show simplification the most, and where it faces away
+static const float SILHOUETTE_ERROR_FACTOR = 0.25f;
+static const float BACKFACING_ERROR_FACTOR = 4.0f;
+// front vertices visited plus faces patched between time budget checks
+static const unsigned int TIME_CHECK_INTERVAL = 64;
+// slot of the faces folded away
+static const unsigned int FOLDED_FACE = ~0u;
+// dirty slots this close are uploaded as one range, fewer calls for a few extra bytes
+static const unsigned int DIRTY_MERGE_GAP = 16;
+
+void utils::ViewDependentRefinement::load(const std::vector<int> &candidatesMap, const scene::Mesh::SubMesh *input)
+{
+    const unsigned int count = std::min(candidatesMap.size(), input->vertices.size());
+    this->parents.resize(count);
+    this->childStart.assign(count + 1, 0);
+    this->positions.resize(count);
+    this->radius.assign(count, 0.0f);
+    this->coneAxis.resize(count);
+    std::vector<float> coneAngle(count, 0.0f);
+    this->foldError.assign(count, 0.0f);
+
+    for (unsigned int i = 0; i < count; i++) {
+        // candidates always have a lower index, the last vertex left is the root
+        this->parents[i] = i > 0 && candidatesMap[i] >= 0 && (unsigned int)candidatesMap[i] < i ? candidatesMap[i] : 0;
+        this->positions[i] = input->vertices[i].position;
+        float normalLength = glm::length(input->vertices[i].normal);
+        // no normal, the cone takes every direction
+        this->coneAxis[i] = normalLength > 0.0f ? input->vertices[i].normal / normalLength : glm::vec3(0.0f);
+        coneAngle[i] = normalLength > 0.0f ? 0.0f : glm::pi<float>();
+
+        if (i > 0) { this->childStart[this->parents[i] + 1]++; }
+    }
+
+    for (unsigned int i = 1; i <= count; i++) { this->childStart[i] += this->childStart[i - 1]; }
+
+    this->children.resize(count > 0 ? count - 1 : 0);
+    std::vector<unsigned int> cursors(this->childStart.begin(), this->childStart.end() - 1);
+
+    for (unsigned int i = 1; i < count; i++) { this->children[cursors[this->parents[i]]++] = i; }
+
+    // children have higher indices, walking down every subtree is done before its parent
+    for (unsigned int i = count; i-- > 1;) {
+        unsigned int parent = this->parents[i];
+        float distance = glm::length(this->positions[i] - this->positions[parent]);
+        this->foldError[i] = distance + this->radius[i];
+        this->radius[parent] = std::max(this->radius[parent], this->foldError[i]);
+        float axisAngle = std::acos(glm::clamp(glm::dot(this->coneAxis[i], this->coneAxis[parent]), -1.0f, 1.0f));
+        axisAngle = glm::length(this->coneAxis[parent]) > 0.0f ? axisAngle : glm::pi<float>();
+        coneAngle[parent] = std::min(glm::pi<float>(), std::max(coneAngle[parent], axisAngle + coneAngle[i]));
+    }
+
+    this->coneSin.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        this->coneSin[i] = coneAngle[i] >= glm::pi<float>() * 0.5f ? 1.0f : std::sin(coneAngle[i]);
+    }
+
+    // full resolution to start with, same as the non refined mesh
+    this->active.assign(count, true);
+    this->activeChildren.resize(count);
+    this->activeVertices.resize(count);
+    this->activeSlot.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        this->activeChildren[i] = this->childStart[i + 1] - this->childStart[i];
+        this->activeVertices[i] = this->activeSlot[i] = i;
+    }
+
+    this->cursor = 0;
+    // preorder keeps every subtree contiguous, children are pushed last to first
+    this->order.clear();
+    this->orderStart.resize(count);
+    this->subtreeSize.assign(count, 1);
+    std::vector<unsigned int> stack;
+
+    if (count > 0) { stack.push_back(0); }
+
+    while (!stack.empty()) {
+        unsigned int v = stack.back();
+        stack.pop_back();
+        this->orderStart[v] = this->order.size();
+        this->order.push_back(v);
+
+        for (unsigned int i = this->childStart[v + 1]; i-- > this->childStart[v];) { stack.push_back(this->children[i]); }
+    }
+
+    for (unsigned int i = count; i-- > 1;) { this->subtreeSize[this->parents[i]] += this->subtreeSize[i]; }
+
+    // faces around each vertex, corners past the hierarchy never fold
+    const unsigned int faceCount = input->faces.size();
+    this->faceCorners.resize(faceCount * 3);
+    this->vertexFaceStart.assign(count + 1, 0);
+
+    for (unsigned int i = 0; i < faceCount; i++) {
+        for (int j = 0; j < 3; j++) {
+            this->faceCorners[i * 3 + j] = input->faces[i].indices[j];
+
+            if (this->faceCorners[i * 3 + j] < count) { this->vertexFaceStart[this->faceCorners[i * 3 + j] + 1]++; }
+        }
+    }
+
+    for (unsigned int i = 1; i <= count; i++) { this->vertexFaceStart[i] += this->vertexFaceStart[i - 1]; }
+
+    this->vertexFaces.resize(this->vertexFaceStart[count]);
+    cursors.assign(this->vertexFaceStart.begin(), this->vertexFaceStart.end() - 1);
+
+    for (unsigned int i = 0; i < faceCount * 3; i++) {
+        if (this->faceCorners[i] < count) { this->vertexFaces[cursors[this->faceCorners[i]]++] = i / 3; }
+    }
+
+    // every vertex kept, the front is the input faces in order
+    this->representatives.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) { this->representatives[i] = i; }
+
+    this->indices.clear();
+    this->slotFace.clear();
+    this->faceSlot.assign(faceCount, FOLDED_FACE);
+    this->dirtySlots.clear();
+
+    for (unsigned int i = 0; i < faceCount; i++) { patchFace(i); }
+
+    this->uploadAll = true;
+}
+
+bool utils::ViewDependentRefinement::needsVertex(const unsigned int v, const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective) const
+{
+    glm::vec3 toViewPoint = viewPoint - this->positions[v];
+    float viewDistance = glm::length(toViewPoint);
+    float distance = viewDistance - this->radius[v];
+
+    // view point inside the subtree bounds
+    if (perspective && distance <= 0.0f) { return true; }
+
+    float screenError = this->foldError[v] * pixelsPerUnit / (perspective ? distance : 1.0f);
+    float facing = viewDistance > 0.0f ? glm::dot(this->coneAxis[v], toViewPoint) / viewDistance : 0.0f;
+    float allowedError = this->pixelError;
+
+    if (std::abs(facing) <= this->coneSin[v]) { allowedError *= SILHOUETTE_ERROR_FACTOR; }
+    else if (facing < 0.0f) { allowedError *= BACKFACING_ERROR_FACTOR; }
+
+    return screenError > allowedError;
+}
+
+unsigned int utils::ViewDependentRefinement::activate(const unsigned int v)
+{
+    this->active[v] = true;
+    this->activeChildren[this->parents[v]]++;
+    this->activeSlot[v] = this->activeVertices.size();
+    this->activeVertices.push_back(v);
+    // the parent was kept and nothing below v, the whole subtree now draws as v
+    return relink(v, v);
+}
+
+unsigned int utils::ViewDependentRefinement::deactivate(const unsigned int v)
+{
+    this->active[v] = false;
+    this->activeChildren[this->parents[v]]--;
+    // the last front vertex takes the slot
+    unsigned int slot = this->activeSlot[v];
+    this->activeVertices[slot] = this->activeVertices.back();
+    this->activeSlot[this->activeVertices[slot]] = slot;
+    this->activeVertices.pop_back();
+    // no children were kept, the whole subtree now draws as the parent
+    return relink(v, this->parents[v]);
+}
+
+unsigned int utils::ViewDependentRefinement::relink(const unsigned int v, const unsigned int representative)
+{
+    const unsigned int first = this->orderStart[v], last = first + this->subtreeSize[v];
+    unsigned int patched = 0;
+
+    for (unsigned int i = first; i < last; i++) { this->representatives[this->order[i]] = representative; }
+
+    for (unsigned int i = first; i < last; i++) {
+        const unsigned int u = this->order[i];
+
+        for (unsigned int j = this->vertexFaceStart[u]; j < this->vertexFaceStart[u + 1]; j++) {
+            patchFace(this->vertexFaces[j]);
+        }
+
+        patched += this->vertexFaceStart[u + 1] - this->vertexFaceStart[u];
+    }
+
+    return patched;
+}
+
+void utils::ViewDependentRefinement::patchFace(const unsigned int face)
+{
+    const unsigned int count = this->representatives.size();
+    unsigned int corners[3];
+
+    for (int j = 0; j < 3; j++) {
+        const unsigned int corner = this->faceCorners[face * 3 + j];
+        corners[j] = corner < count ? this->representatives[corner] : corner;
+    }
+
+    const bool folded = corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0];
+    unsigned int slot = this->faceSlot[face];
+
+    if (folded) {
+        if (slot == FOLDED_FACE) { return; }
+
+        // the last front face takes the slot
+        const unsigned int lastFace = this->slotFace.back();
+        std::copy(this->indices.end() - 3, this->indices.end(), this->indices.begin() + slot * 3);
+        this->slotFace[slot] = lastFace;
+        this->faceSlot[lastFace] = slot;
+        this->faceSlot[face] = FOLDED_FACE;
+        this->slotFace.pop_back();
+        this->indices.resize(this->indices.size() - 3);
+
+        if (slot < this->slotFace.size()) { this->dirtySlots.push_back(slot); }
+
+        return;
+    }
+
+    if (slot == FOLDED_FACE) {
+        slot = this->faceSlot[face] = this->slotFace.size();
+        this->slotFace.push_back(face);
+        this->indices.resize(this->indices.size() + 3);
+    } else if (std::equal(corners, corners + 3, this->indices.begin() + slot * 3)) {
+        return;
+    }
+
+    std::copy(corners, corners + 3, this->indices.begin() + slot * 3);
+    this->dirtySlots.push_back(slot);
+}
+
+bool utils::ViewDependentRefinement::update(const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective)
+{
+    if (this->activeVertices.empty()) { return false; }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    bool changed = false;
+    // at most one pass over the front per call
+    unsigned int remaining = this->activeVertices.size();
+    unsigned int work = 0, nextCheck = TIME_CHECK_INTERVAL;
+
+    for (; remaining > 0; remaining--) {
+        if (this->cursor >= this->activeVertices.size()) { this->cursor = 0; }
+
+        unsigned int v = this->activeVertices[this->cursor];
+
+        // a vertex folds only after all of its children did, the root never does
+        if (v != 0 && this->activeChildren[v] == 0 && !needsVertex(v, viewPoint, pixelsPerUnit, perspective)) {
+            // the slot now holds another front vertex, visited next
+            work += deactivate(v);
+            changed = true;
+        } else {
+            for (unsigned int i = this->childStart[v]; i < this->childStart[v + 1]; i++) {
+                unsigned int child = this->children[i];
+
+                if (!this->active[child] && needsVertex(child, viewPoint, pixelsPerUnit, perspective)) {
+                    work += activate(child);
+                    changed = true;
+                }
+            }
+
+            this->cursor++;
+        }
+
+        if (++work < nextCheck) { continue; }
+
+        nextCheck = work + TIME_CHECK_INTERVAL;
+
+        if (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count() > this->timeBudget) { break; }
+    }
+
+    return changed;
+}
+
+void utils::ViewDependentRefinement::takeDirtyRanges(std::vector<scene::Mesh::SubMesh::IndexRange> &out)
+{
+    out.clear();
+    scene::Mesh::SubMesh::IndexRange range;
+
+    if (this->uploadAll) {
+        range.offset = 0; range.count = this->indices.size();
+        out.push_back(range);
+        this->uploadAll = false;
+        this->dirtySlots.clear();
+        return;
+    }
+
+    std::sort(this->dirtySlots.begin(), this->dirtySlots.end());
+    const unsigned int slotCount = this->slotFace.size();
+    unsigned int first = 0, last = 0;
+    bool open = false;
+
+    for (auto it = this->dirtySlots.begin(); it != this->dirtySlots.end(); ++it) {
+        // slots past the front end were removed afterwards
+        if (*it >= slotCount) { break; }
+
+        if (open && *it <= last + DIRTY_MERGE_GAP) {
+            last = std::max(last, *it);
+            continue;
+        }
+
+        if (open) {
+            range.offset = first * 3; range.count = (last - first + 1) * 3;
+            out.push_back(range);
+        }
+
+        first = last = *it;
+        open = true;
+    }
+
+    if (open) {
+        range.offset = first * 3; range.count = (last - first + 1) * 3;
+        out.push_back(range);
+    }
+
+    this->dirtySlots.clear();
+}
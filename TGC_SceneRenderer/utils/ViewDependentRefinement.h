@@ -0,0 +1,87 @@
+#pragma once
+#include "..\Scene\Mesh.h"
+#include <vector>
+
+namespace utils {
+
+    // view dependent refinement over the collapse hierarchy of a progressive mesh, each
+    // vertex parent is its collapse candidate, a vertex is kept while folding its subtree
+    // into the parent shows more screen error than allowed, tighter at the silhouettes and
+    // looser for back facing parts, folded vertices draw as their nearest kept ancestor,
+    // each keep or fold patches the index slots of the faces around the changed subtree
+    class ViewDependentRefinement {
+        public:
+            ViewDependentRefinement() : pixelError(1.0f), timeBudget(2000), cursor(0), uploadAll(false) {};
+
+            // builds the bounds of every vertex subtree, input vertices and faces have
+            // to be already permuted, starts with every vertex kept
+            void load(const std::vector<int> &candidatesMap, const scene::Mesh::SubMesh *input);
+            // keeps and folds the vertices of the active front for viewPoint, in the input model
+            // space, pixelsPerUnit projects a model space length at unit distance, or at any
+            // distance if not perspective, stops once the time budget is spent and continues
+            // from there the next call, the index patching counts against the budget too,
+            // true if the front changed
+            bool update(const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective);
+            // indices of the input faces that stay after folding into the active front, a
+            // face keeps its slot while it stays, the last face takes the slot of a removed one
+            const std::vector<unsigned int> &getIndices() const { return indices; }
+            // index ranges patched since the last call, everything after load
+            void takeDirtyRanges(std::vector<scene::Mesh::SubMesh::IndexRange> &out);
+            bool hasDirtyRanges() const { return uploadAll || !dirtySlots.empty(); }
+            unsigned int getActiveCount() const { return activeVertices.size(); }
+
+            // screen error in pixels allowed for a folded subtree
+            void setPixelError(const float val) { pixelError = val; }
+            float getPixelError() const { return pixelError; }
+            // microseconds an update call can spend walking the front
+            void setTimeBudget(const long long val) { timeBudget = val; }
+            long long getTimeBudget() const { return timeBudget; }
+
+        private:
+            float pixelError;
+            long long timeBudget;
+            // collapse hierarchy, children of vertex i are children[childStart[i], childStart[i + 1])
+            std::vector<unsigned int> parents;
+            std::vector<unsigned int> childStart;
+            std::vector<unsigned int> children;
+            // per vertex subtree bounds, sphere around the vertex position and normals cone
+            std::vector<glm::vec3> positions;
+            std::vector<float> radius;
+            std::vector<glm::vec3> coneAxis;
+            std::vector<float> coneSin;
+            // distance the subtree moves at most if folded into the parent
+            std::vector<float> foldError;
+            // active front, kept vertices and their slot in activeVertices
+            std::vector<bool> active;
+            std::vector<unsigned int> activeChildren;
+            std::vector<unsigned int> activeVertices;
+            std::vector<unsigned int> activeSlot;
+            // next activeVertices slot to visit
+            unsigned int cursor;
+            // nearest kept ancestor of every vertex
+            std::vector<unsigned int> representatives;
+            // hierarchy preorder, the subtree of vertex i is order[orderStart[i], orderStart[i] + subtreeSize[i])
+            std::vector<unsigned int> order;
+            std::vector<unsigned int> orderStart;
+            std::vector<unsigned int> subtreeSize;
+            // input faces corners and the faces around vertex i, vertexFaces[vertexFaceStart[i], vertexFaceStart[i + 1])
+            std::vector<unsigned int> faceCorners;
+            std::vector<unsigned int> vertexFaceStart;
+            std::vector<unsigned int> vertexFaces;
+            // front faces, face slot in indices, all bits set if folded away, and the face in every slot
+            std::vector<unsigned int> indices;
+            std::vector<unsigned int> faceSlot;
+            std::vector<unsigned int> slotFace;
+            // slots written since the last takeDirtyRanges
+            std::vector<unsigned int> dirtySlots;
+            bool uploadAll;
+            bool needsVertex(const unsigned int v, const glm::vec3 &viewPoint, const float pixelsPerUnit, const bool perspective) const;
+            // both return the faces patched
+            unsigned int activate(const unsigned int v);
+            unsigned int deactivate(const unsigned int v);
+            // every vertex of the v subtree draws as representative, patches the faces around them
+            unsigned int relink(const unsigned int v, const unsigned int representative);
+            // rewrites the face slot from the current representatives, adds or removes it from the front
+            void patchFace(const unsigned int face);
+    };
+}